@@ -28,6 +28,7 @@
  */
 #include <stddef.h>
 #include <stdint.h>
+#include <stdarg.h>
 
 typedef uint8_t boolean_t;
 #ifndef TRUE
@@ -109,14 +110,17 @@ typedef uint8_t boolean_t;
 
 #define ARM_GIC_BASE_OFFSET   0x00100  // Generic Interrupt Controller
 #define ARM_GST_BASE_OFFSET   0x00200  // Global System Timer
-// TODO 
-// TODO #define ARM_PWT_BASE_OFFSET   0x00200  // Private Watchd dogs and Timers
-#define ARM_PWT_BASE_OFFSET   0x06000  // Private Watchd dogs and Timers
-// TODO private timer
+#define ARM_PWT_BASE_OFFSET   0x00600  // Private Timer and Watchdog
 #define ARM_GID_BASE_OFFSET   0x01000  // Generic Interrupt Distributor
 
 #define CORTEX_A9_NIRQS           96
 
+/*
+ * The global timer and the private timers and watchdogs are clocked by PERIPHCLK.
+ * QEMU models them with a period of 10ns, that is, a 100MHz clock.
+ */
+#define CORTEX_A9_PERIPHCLK_HZ    100000000
+
 /*
  * Configuration Base Address Register takes the physical base address value at reset.
  *    - In Cortex-A9 uniprocessor implementations the base address is set to zero.
@@ -143,6 +147,13 @@ uintptr_t cortex_a9_peripheral_base() {
 #define UART1_IRQ 13
 #define UART2 ((void*)0x101f3000)
 #define UART2_IRQ 14
+/*
+ * SP804 dual timers: timers 0 and 1, timers 2 and 3.
+ */
+#define SP804_0 ((void*)0x101e2000)
+#define SP804_0_IRQ 4
+#define SP804_1 ((void*)0x101e3000)
+#define SP804_1_IRQ 5
 #endif
 
 #ifdef vexpress_a9
@@ -168,6 +179,13 @@ uintptr_t cortex_a9_peripheral_base() {
 #define UART2_IRQ (32+7)
 #define UART3 ((void*)0x1000c000)
 #define UART3_IRQ (32+8)
+/*
+ * SP804 dual timers of the motherboard: timers 0 and 1, timers 2 and 3.
+ */
+#define SP804_0 ((void*)0x10011000)
+#define SP804_0_IRQ (32+2)
+#define SP804_1 ((void*)0x10012000)
+#define SP804_1_IRQ (32+3)
 
 #endif
 
@@ -333,6 +351,13 @@ _arm_mmio_clearsetbits32(uintptr_t base, uint32_t off, uint32_t mask, uint32_t b
 
 void kprintf(const char *fmt, ...);
 
+/**
+ * Bounded formatting into a buffer, see kprintf.c.
+ * Return the length the formatted string would have had without the bound.
+ */
+int ksnprintf(char *str, size_t size, const char *fmt, ...);
+int kvsnprintf(char *str, size_t size, const char *fmt, va_list ap);
+
 
 /**
  * Assert: the intent is to check for possible abnormal conditions
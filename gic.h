@@ -35,6 +35,7 @@
 #define CPSR_ABT_MODE 0x17
 #define CPSR_UND_MODE 0x1B
 #define CPSR_SYS_MODE 0x1F
+#define CPSR_MODE_MASK 0x1F
 
 #define CPSR_IRQ_FLAG   0x80      /* when set, IRQs are disabled, at the core level */
 #define CPSR_FIQ_FLAG   0x40      /* when set, FIQs are disabled, at the core level */
@@ -43,6 +44,19 @@
 typedef uint32_t irq_id_t;
 typedef uint32_t cpu_id_t;
 
+/*
+ * The state of the interrupted code, as saved by _arm_irq_handler (gic.s)
+ * on the SYS mode stack, and given to irq_handler:
+ * the caller-save registers, r4, the SYS mode LR,
+ * and the return state (PC and CPSR) stored by srsdb.
+ */
+struct irq_frame {
+  uint32_t r0, r1, r2, r3, r4, r12;
+  uint32_t lr;
+  uint32_t pc;
+  uint32_t cpsr;
+};
+
 /*
  * Enables IRQs, FIQs unchanged.
  *    No MODE change... probably in SYS_MODE.
@@ -87,6 +101,16 @@ int arm_disable_interrupts(void) {
   return (old & 0x80) == 0;
 }
 
+/*
+ * Returns the current processor mode (CPSR_*_MODE).
+ */
+ALWAYS_INLINE
+uint32_t arm_mode(void) {
+  uint32_t cpsr;
+  __asm__ __volatile__("mrs %0, cpsr" : "=r" (cpsr));
+  return cpsr & CPSR_MODE_MASK;
+}
+
 
 /*
  * Generic Interrupt Controller
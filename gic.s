@@ -95,6 +95,7 @@ _arm_irq_init:
      *   One 4KB stack for the USR and SYS modes
      *   One 256B stack for the IRQ mode.
      *   One 256B stack for the SVC mode.
+     *   One 1KB stack for the ABT mode, that reports the data aborts.
      *   One 256B stack shared by all other modes that are not used.
 	 *----------------------------------------------*/
 	MSR     CPSR_c,#(CPSR_IRQ_MODE | CPSR_IRQ_FLAG | CPSR_FIQ_FLAG)
@@ -171,6 +172,52 @@ _arm_irq_init:
 	.size   _arm_irq_init, . - _arm_irq_init
 	.endfunc
 
+/**
+ * Entry point of the secondary processors (see ksmp.c), in SVC mode with the
+ * MMU and the caches disabled: set the stacks of the processor in ksmpStacks,
+ * for the IRQ mode, the ABT mode, the other exception modes, and the SYS mode (C stack),
+ * share the exception vector of the boot processor, enable the L1 caches,
+ * and call ksmp_secondary_main with the processor number (r0).
+ */
+	.global _secondary_entry
+	.func _secondary_entry
+_secondary_entry:
+	mrc p15, 0, r0, c0, c0, 5 @ Multiprocessor Affinity Register
+	and r0, r0, #3            @ processor number
+	ldr r1,=ksmpStacks
+	add r1, r1, r0, lsl #13   @ KSMP_STACK_SHIFT
+
+	MSR     CPSR_c,#(CPSR_IRQ_MODE | CPSR_IRQ_FLAG | CPSR_FIQ_FLAG)
+	add     sp, r1, #0x800
+	MSR     CPSR_c,#(CPSR_FIQ_MODE | CPSR_IRQ_FLAG | CPSR_FIQ_FLAG)
+	add     sp, r1, #0x400
+	MSR     CPSR_c,#(CPSR_SVC_MODE | CPSR_IRQ_FLAG | CPSR_FIQ_FLAG)
+	add     sp, r1, #0x400
+	MSR     CPSR_c,#(CPSR_ABT_MODE | CPSR_IRQ_FLAG | CPSR_FIQ_FLAG)
+	add     sp, r1, #0xC00
+	MSR     CPSR_c,#(CPSR_UND_MODE | CPSR_IRQ_FLAG | CPSR_FIQ_FLAG)
+	add     sp, r1, #0x400
+	MSR     CPSR_c,#(CPSR_SYS_MODE | CPSR_IRQ_FLAG | CPSR_FIQ_FLAG)
+	add     sp, r1, #0x2000   @ KSMP_STACK_SIZE
+
+	ldr r1,=_primary
+	mcr p15, 0, r1, c12, c0, 0 @ Vector Base Address Register
+
+	mrc p15, 0, r1, c1, c0, 0 @ Read Control Register configuration data
+	orr r1, r1, #(0x1 << 12)  @ enable I Cache
+	orr r1, r1, #(0x1 << 2)   @ enable D Cache
+	orr r1, r1, #(0x1 << 11)  @ branch prediction
+	mcr p15, 0, r1, c1, c0, 0 @ Write Control Register configuration data
+	isb
+
+	bl ksmp_secondary_main
+1:
+	wfi
+	b 1b
+
+	.size   _secondary_entry, . - _secondary_entry
+	.endfunc
+
 .p2align 8
 _primary:
 	ldr pc,[pc,#0x18] /* 0x00 reset */
@@ -183,7 +230,7 @@ _primary:
 	ldr pc,[pc,#0x18] /* 0x1c FIQ */
 _secondary:
 	.word _reset_loop
-	.word _undef_loop
+	.word _arm_undef_handler
 	.word _swi_handler  /* _softirq_loop */
 	.word _prefetch_loop
 	.word _arm_data_abort
@@ -248,6 +295,47 @@ _arm_usr_mode:
 	.size   _arm_usr_mode, . - _arm_usr_mode
 	.endfunc
 
+/*
+ * Context switch between two kernel threads, in SYS mode, with the interrupts disabled
+ * (see kthread.c). The caller-saved registers are saved by the caller (AAPCS), so only
+ * the CPSR, the callee-saved registers and LR are pushed on the stack of the current
+ * thread, whose SP (the SYS/USR banked SP) is then saved in the thread.
+ * The same is popped from the stack of the next thread: 10 words, so that the
+ * 8-byte alignment of the stack is kept.
+ * A thread preempted from the IRQ exit path also has its interrupted state on its stack,
+ * below this frame: the SPSR and return address stored by srsdb, and the caller-saved
+ * registers pushed by _arm_irq_handler.
+ *
+ * r0 = address where to save the SP of the current thread
+ * r1 = SP of the next thread
+ */
+	.global _kthread_switch
+	.func _kthread_switch
+_kthread_switch:
+	mrs r2, cpsr
+	push {r2, r4-r11, lr}
+	str sp, [r0]
+	mov sp, r1
+	pop {r2, r4-r11, lr}
+	msr cpsr_c, r2
+	bx lr
+	.size   _kthread_switch, . - _kthread_switch
+	.endfunc
+
+/*
+ * First switch to a new thread: _kthread_switch returns here, with the function
+ * and its argument in r4 and r5 (see kthread_create).
+ */
+	.global _kthread_start
+	.func _kthread_start
+_kthread_start:
+	mov r0, r4
+	mov r1, r5
+	bl kthread_start
+	b _arm_halt               @ kthread_start never returns
+	.size   _kthread_start, . - _kthread_start
+	.endfunc
+
 /*
  * This is the termination of a user-mode process.
  * Change to SYS mode, with IRQs and FIQs still disabled.
@@ -349,6 +437,24 @@ _swi_handler:
 _reset_loop: /* for debug, because we loop here, so we know why */
 	b _reset_loop;
 
+/*
+ * Undefined instruction: the first FP instruction of a thread that does not own
+ * the FP unit (see kvfp.c) is re-executed once the unit is given to the thread.
+ * LR points to the next instruction (ARM state), so the undefined one is at LR-4.
+ * Any other undefined instruction loops on _undef_loop.
+ */
+_arm_undef_handler:
+	push {r0-r4, r12, lr}
+	sub r0, lr, #4
+	and r4, sp, #4             @ 8-byte alignment, see _arm_irq_handler
+	sub sp, sp, r4
+	bl kvfp_undef
+	add sp, sp, r4
+	cmp r0, #0
+	pop {r0-r4, r12, lr}
+	beq _undef_loop
+	subs pc, lr, #4            @ re-execute, restoring CPSR from SPSR
+
 _undef_loop: /* for debug, because we loop here, so we know why */
 	b _undef_loop;
 
@@ -413,6 +519,14 @@ _arm_data_abort:
 	mrc p15, 0, r0, c5, c0, 0 @ Read DFSR
 	mrc p15, 0, r1, c6, c0, 0 @ Read DFAR
 
+	/*
+	 * Report a stack overflow in a guard page, on the ABT stack
+	 * since the SYS one may be the overflowed one (see kstack.c).
+	 */
+	bl kstack_fault
+	mrc p15, 0, r0, c5, c0, 0 @ Read DFSR
+	mrc p15, 0, r1, c6, c0, 0 @ Read DFAR
+
     /*
      * Switch back to sys mode so that we have access
      * to the C stack from the debugger.
@@ -460,6 +574,12 @@ _arm_irq_handler:
 	 */
 	push {r0-r4, r12, lr}
 
+	/*
+	 * The stack now holds the state of the interrupted code
+	 * (see struct irq_frame in gic.h), given as argument to irq_handler.
+	 */
+	mov r0, sp
+
 	/* According to the document "Procedure Call Standard for the ARM
 	 * Architecture", the stack pointer is 4-byte aligned at all times, but
 	 * it must be 8-byte aligned when calling an externally visible
@@ -474,6 +594,15 @@ _arm_irq_handler:
 	/* Call the board-level function that handles Interrupt ReQuests (IRQ). */
 	bl irq_handler
 
+	/*
+	 * Preempt the interrupted thread if needed (see kthread.c): its state is saved
+	 * on its stack, the IRQ return below is done once it is switched back.
+	 * irq_handler returns with the interrupts enabled: disable them again, so that
+	 * the switch is done with no nested IRQ frame piling on the thread stack.
+	 */
+	cpsid i
+	bl kthread_irq_exit
+
 	/*
 	 * Restore the original stack alignment
 	 * (see note about 8-byte alignment above).
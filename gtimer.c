@@ -0,0 +1,16 @@
+#include "gtimer.h"
+
+
+
+
+/**
+ * Start the global timer, without prescaler, if it is not already running.
+ */
+void gtimer_init()
+{
+	uintptr_t base = cortex_a9_peripheral_base() + ARM_GST_BASE_OFFSET;
+	uint32_t control = arm_mmio_read32(base, GTIMER_OFF_REGISTER_CONTROL);
+
+	if (!getBit32(control, GTIMER_BIT_REGISTER_CONTROL_TIMER_ENABLE))
+		arm_mmio_write32(base, GTIMER_OFF_REGISTER_CONTROL, setBit32(0, GTIMER_BIT_REGISTER_CONTROL_TIMER_ENABLE));
+}
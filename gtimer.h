@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) SID LAKHDAR Riyane.
+ *
+ * This code is a patch to the code implemented by Pr Olivier 
+ * Gruber during the Advanced Operating System cours.
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Classpath; see the file COPYING.  If not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA.
+ *
+ */
+
+#ifndef GTIMER_H
+#define GTIMER_H
+
+#include "board.h"
+
+
+
+/**
+ * Offset of the global timer registers (relative to
+ * the base address of the global timer memory region: ARM_GST_BASE_OFFSET)
+ * The global timer is a 64-bit incrementing counter, clocked by PERIPHCLK,
+ * shared by all the Cortex-A9 processors.
+ */
+#define GTIMER_OFF_REGISTER_COUNTER_LOW		0x00
+#define GTIMER_OFF_REGISTER_COUNTER_HIGH	0x04
+#define GTIMER_OFF_REGISTER_CONTROL		0x08
+
+
+/**
+ * Index in the global timer control register where to find the given informations
+ */
+#define GTIMER_BIT_REGISTER_CONTROL_TIMER_ENABLE	0
+
+
+
+
+void	gtimer_init	();
+
+
+/**
+ * Full 64 bits of the global timer counter.
+ * The two halves are read in two accesses: the upper half is read before and
+ * after the lower half, and the read is retried if the lower half wrapped
+ * in between (at most once every 42s at 100MHz).
+ */
+ALWAYS_INLINE
+uint64_t gtimer_read()
+{
+	uintptr_t	base = cortex_a9_peripheral_base() + ARM_GST_BASE_OFFSET;
+	uint32_t	high, low;
+
+	do
+	{
+		high	= arm_mmio_read32(base, GTIMER_OFF_REGISTER_COUNTER_HIGH);
+		low	= arm_mmio_read32(base, GTIMER_OFF_REGISTER_COUNTER_LOW);
+	} while (high != arm_mmio_read32(base, GTIMER_OFF_REGISTER_COUNTER_HIGH));
+
+	return ((uint64_t)high << 32) | low;
+}
+
+
+/**
+ * Lower 32 bits of the global timer counter.
+ * Enough to measure intervals shorter than 2^32 ticks (about 42s at 100MHz).
+ */
+ALWAYS_INLINE
+uint32_t gtimer_read_low()
+{
+	return arm_mmio_read32(cortex_a9_peripheral_base() + ARM_GST_BASE_OFFSET, GTIMER_OFF_REGISTER_COUNTER_LOW);
+}
+
+
+
+#endif
@@ -0,0 +1,59 @@
+#include "kbench.h"
+
+
+
+
+#define KBENCH_BUFFER_SIZE		128
+
+
+/**
+ * Formats measured by the benchmark: the usual formats of the kernel traces.
+ */
+typedef struct K_BENCH_FORMAT
+{
+	const char	*name;
+	const char	*fmt;
+} kBenchFormat;
+
+static const kBenchFormat kbenchFormats[] =
+{
+	{"literal",	"Initialized malloc/free\n"},
+	{"decimal",	"    -> %d allocated pages \n"},
+	{"hexa",	"+++ counter = 0x%x\n"},
+	{"padded",	"  CTLR:    0x%08x\n"},
+	{"string",	"USER[%d]: %s\n"},
+	{"launch",	"--> launching user pid=%d...\n"},
+};
+
+
+
+
+/**
+ * Measure the throughput of ksnprintf() on each format of kbenchFormats.
+ * For each format, print the cost of one formatting in global timer ticks
+ * and the produced throughput in KB/s.
+ */
+void kbench_kprintf()
+{
+	char		buffer[KBENCH_BUFFER_SIZE];
+	unsigned int	i, j;
+
+	gtimer_init();
+	kprintf("kprintf benchmark: %d formatting per format\n\r", KBENCH_KPRINTF_NB_ITER);
+	for (i=0; i<sizeof(kbenchFormats)/sizeof(kBenchFormat); i++)
+	{
+		uint64_t	nbBytes = 0;
+		uint32_t	start, ticks;
+
+		start = gtimer_read_low();
+		for (j=0; j<KBENCH_KPRINTF_NB_ITER; j++)
+			nbBytes += ksnprintf(buffer, KBENCH_BUFFER_SIZE, kbenchFormats[i].fmt, j, "bench");
+		ticks = gtimer_read_low() - start;
+		if (ticks == 0)
+			ticks = 1;
+
+		kprintf("  %s: %d ticks/call, %d KB/s\n\r", kbenchFormats[i].name,
+			ticks / KBENCH_KPRINTF_NB_ITER,
+			(uint32_t)((nbBytes * CORTEX_A9_PERIPHCLK_HZ) / ticks / 1024));
+	}
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) SID LAKHDAR Riyane.
+ *
+ * This code is a patch to the code implemented by Pr Olivier 
+ * Gruber during the Advanced Operating System cours.
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Classpath; see the file COPYING.  If not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA.
+ *
+ */
+
+#ifndef K_BENCH_H
+#define K_BENCH_H
+
+#include "board.h"
+#include "gtimer.h"
+
+
+
+
+/**
+ * Number of formatting per benchmarked format
+ */
+#define KBENCH_KPRINTF_NB_ITER	10000
+
+
+void	kbench_kprintf		();
+
+
+
+#endif
@@ -0,0 +1,40 @@
+#include "kclock.h"
+
+
+struct kclock	kclock;
+
+
+
+
+/**
+ * Compute the largest shift (at most 32) such that mult = (to << shift) / from
+ * still fits in 32 bits, that is the best precision of the conversion from
+ * a unit of frequency "from" to a unit of frequency "to".
+ * mult is rounded up: a converted delay is never shorter than requested.
+ */
+static void kclock_compute_mult_shift(uint32_t *mult, uint32_t *shift, uint64_t from, uint64_t to)
+{
+	uint32_t	s;
+	uint64_t	m;
+
+	for (s=32; s>0; s--)
+	{
+		m = ((to << s) + from - 1) / from;
+		if ((m >> 32) == 0)
+			break;
+	}
+	*mult	= (uint32_t)m;
+	*shift	= s;
+}
+
+
+/**
+ * Start the global timer, and compute the conversion factors.
+ */
+void kclock_init()
+{
+	gtimer_init();
+	kclock.freq = CORTEX_A9_PERIPHCLK_HZ;
+	kclock_compute_mult_shift(&kclock.mult,   &kclock.shift,   kclock.freq, NSEC_PER_SEC);
+	kclock_compute_mult_shift(&kclock.nsMult, &kclock.nsShift, NSEC_PER_SEC, kclock.freq);
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) SID LAKHDAR Riyane.
+ *
+ * This code is a patch to the code implemented by Pr Olivier 
+ * Gruber during the Advanced Operating System cours.
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Classpath; see the file COPYING.  If not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA.
+ *
+ */
+
+
+#ifndef KCLOCK_H
+#define KCLOCK_H
+
+#include "board.h"
+#include "gtimer.h"
+
+
+/**
+ * Clocksource of the kernel: a monotonic 64-bit time base, backed by
+ * the free-running global timer.
+ * The conversions between cycles and nanoseconds avoid any division:
+ *	ns	= (cycles * mult) >> shift
+ * with mult and shift computed once, at initialization, from the clock
+ * frequency, so that mult fits in 32 bits with the best precision.
+ */
+#define NSEC_PER_SEC	1000000000ULL
+
+struct kclock
+{
+	uint32_t	freq;		// Frequency of the counter (Hz)
+	uint32_t	mult;		// Cycles to ns
+	uint32_t	shift;
+	uint32_t	nsMult;		// Ns to cycles
+	uint32_t	nsShift;
+};
+
+extern struct kclock	kclock;
+
+
+
+void		kclock_init	();
+
+
+/**
+ * Multiply the 64-bit value by mult, and shift the result right.
+ * The product is split in two 32x32->64 multiplications, on the upper and lower
+ * halves of the value, so that it does not overflow for the 64-bit counter
+ * (a plain 64x32 multiplication would overflow after about 20 minutes at 100MHz).
+ * shift must not be greater than 32.
+ */
+ALWAYS_INLINE
+uint64_t kclock_scale(uint64_t value, uint32_t mult, uint32_t shift)
+{
+	uint64_t	high	= (uint64_t)(uint32_t)(value >> 32) * mult;
+	uint64_t	low	= (uint64_t)(uint32_t)value * mult;
+
+	return (high << (32 - shift)) + (low >> shift);
+}
+
+
+/**
+ * Current value of the clocksource counter, in cycles.
+ */
+ALWAYS_INLINE
+uint64_t cycles()
+{
+	return gtimer_read();
+}
+
+
+ALWAYS_INLINE
+uint64_t kclock_cycles_to_ns(uint64_t cycles)
+{
+	return kclock_scale(cycles, kclock.mult, kclock.shift);
+}
+
+
+ALWAYS_INLINE
+uint64_t kclock_ns_to_cycles(uint64_t ns)
+{
+	return kclock_scale(ns, kclock.nsMult, kclock.nsShift);
+}
+
+
+/**
+ * Monotonic time since the start of the global timer, in nanoseconds.
+ */
+ALWAYS_INLINE
+uint64_t ktime_get_ns()
+{
+	return kclock_cycles_to_ns(cycles());
+}
+
+
+
+#endif
@@ -0,0 +1,619 @@
+#include "kconsole.h"
+#include "kmem.h"
+#include "kirqStats.h"
+#include "kirqPendingList.h"
+#ifdef vexpress_a9
+#include "timer.h"
+#include "gtimer.h"
+#include "kclock.h"
+#include "ktimer.h"
+#include "kevent.h"
+#include "ksmp.h"
+#include "kcoro.h"
+#include "kthread.h"
+#include "kstack.h"
+#include "kidle.h"
+#include "ktrace.h"
+#include "kprof.h"
+#include "kpmu.h"
+#include "kprobe.h"
+#include "klatency.h"
+#endif
+
+
+
+
+/**
+ * The console reads command lines on its input port, from the bottom half of the port,
+ * and writes the command outputs on its output port, through the port TX ring.
+ * All the buffers are preallocated, so that running a command does not use
+ * the malloc/free subsystem and perturbs as little as possible the measured system.
+ */
+static struct uart_port	*consoleIn;
+static struct uart_port	*consoleOut;
+
+static char		consoleLine[KCONSOLE_LINE_SIZE];
+static uint32_t		consoleLineLength;
+static char		consoleBuffer[KCONSOLE_OUT_SIZE];
+
+static kConsoleEntry	consoleCommands[KCONSOLE_MAX_COMMANDS];
+static int		nbConsoleCommands;
+
+
+
+
+/**
+ * Format the given output into the console buffer and send it on the output port.
+ * Outputs longer than the console buffer are truncated.
+ */
+void kconsole_printf(const char *fmt, ...)
+{
+	va_list		ap;
+	uint32_t	length;
+
+	va_start(ap, fmt);
+	length = kvsnprintf(consoleBuffer, KCONSOLE_OUT_SIZE, fmt, ap);
+	va_end(ap);
+
+	if (length >= KCONSOLE_OUT_SIZE)
+		length = KCONSOLE_OUT_SIZE - 1;
+	uart_port_write(consoleOut, (const unsigned char*)consoleBuffer, length);
+}
+
+
+/**
+ * Register a new command, return 0 if there is no room left for it.
+ */
+int kconsole_register(const char *name, const char *help, kConsoleCommand command)
+{
+	if (nbConsoleCommands >= KCONSOLE_MAX_COMMANDS)
+		return 0;
+
+	consoleCommands[nbConsoleCommands].name		= name;
+	consoleCommands[nbConsoleCommands].help		= help;
+	consoleCommands[nbConsoleCommands].command	= command;
+	nbConsoleCommands ++;
+	return 1;
+}
+
+
+static int kconsole_strcmp(const char *s1, const char *s2)
+{
+	while (*s1 != '\0' && *s1 == *s2)
+	{
+		s1++;
+		s2++;
+	}
+	return (unsigned char)*s1 - (unsigned char)*s2;
+}
+
+
+/**
+ * Decimal value of the given word, 0 if it is not a number.
+ */
+static uint32_t kconsole_atoi(const char *s)
+{
+	uint32_t value = 0;
+
+	for (; *s >= '0' && *s <= '9'; s++)
+		value = value * 10 + (*s - '0');
+	return value;
+}
+
+
+/**
+ * Split the current line in words (in place) and run the corresponding command.
+ */
+static void kconsole_execute()
+{
+	char	*argv[KCONSOLE_MAX_ARGS];
+	int	argc = 0;
+	char	*c = consoleLine;
+	int	i;
+
+	consoleLine[consoleLineLength] = '\0';
+	while (*c != '\0' && argc < KCONSOLE_MAX_ARGS)
+	{
+		while (*c == ' ')
+			*c++ = '\0';
+		if (*c == '\0')
+			break;
+		argv[argc++] = c;
+		while (*c != ' ' && *c != '\0')
+			c++;
+	}
+	if (argc == 0)
+		return;
+
+	for (i=0; i<nbConsoleCommands; i++)
+	{
+		if (kconsole_strcmp(argv[0], consoleCommands[i].name) == 0)
+		{
+			consoleCommands[i].command(argc, argv);
+			return;
+		}
+	}
+	kconsole_printf("%s: unknown command, try help\n\r", argv[0]);
+}
+
+
+/**
+ * Consumer of the console input port, upcalled from the port bottom half.
+ * Echo the received characters, and run the command on each end of line.
+ */
+static void kconsole_receive(struct uart_port *port, void *arg)
+{
+	unsigned char c;
+
+	while (uart_port_getc(port, &c))
+	{
+		switch (c)
+		{
+		case '\r':
+		case '\n':
+			uart_port_write(consoleOut, (const unsigned char*)"\r\n", 2);
+			kconsole_execute();
+			consoleLineLength = 0;
+			uart_port_puts(consoleOut, (const unsigned char*)KCONSOLE_PROMPT);
+			break;
+		case 0x08:	// Backspace
+		case 0x7F:	// Delete
+			if (consoleLineLength > 0)
+			{
+				consoleLineLength --;
+				uart_port_write(consoleOut, (const unsigned char*)"\b \b", 3);
+			}
+			break;
+		default:
+			if (c < ' ' || consoleLineLength >= KCONSOLE_LINE_SIZE - 1)
+				break;
+			consoleLine[consoleLineLength++] = c;
+			uart_port_putc(consoleOut, c);
+			break;
+		}
+	}
+}
+
+
+
+
+/**
+ * Built-in commands
+ */
+static void kconsole_help(int argc, char **argv)
+{
+	int i;
+
+	for (i=0; i<nbConsoleCommands; i++)
+		kconsole_printf("  %-8s %s\n\r", consoleCommands[i].name, consoleCommands[i].help);
+}
+
+
+static void kconsole_mem(int argc, char **argv)
+{
+	struct space_stats stats;
+
+	space_valloc_stats(&stats);
+	kconsole_printf("pages: used=%d empty-used=%d free=%d\n\r", stats.npages, stats.nzpages, stats.free_pages);
+	kconsole_printf("chunks: allocated=%d holes=%d bytes=%d\n\r", stats.nchunks, stats.nholes, (uint32_t)stats.allocated);
+}
+
+
+static void kconsole_irq(int argc, char **argv)
+{
+	uint32_t	irq, bucket;
+	kIrqStats	*stats;
+
+	for (irq=0; irq<CORTEX_A9_NIRQS; irq++)
+	{
+		stats = getIrqStats(irq);
+		if (stats->nbTops == 0 && stats->nbBottoms == 0)
+			continue;
+		kconsole_printf("irq %d: tops=%d bottoms=%d max-latency=%d ticks\n\r",
+			irq, stats->nbTops, stats->nbBottoms, stats->maxLatency);
+		for (bucket=0; bucket<IRQ_STATS_NB_BUCKETS; bucket++)
+		{
+			if (stats->latency[bucket] != 0)
+				kconsole_printf("   <%d ticks: %d\n\r", 1 << bucket, stats->latency[bucket]);
+		}
+	}
+}
+
+
+static void kconsole_uart(int argc, char **argv)
+{
+	uint32_t		no;
+	struct uart_port	*port;
+
+	for (no=0; no<uart_nports(); no++)
+	{
+		port = uart_get_port(no);
+		kconsole_printf("uart%d: irq=%d in=%d out=%d dropped=%d overruns=%d framing=%d parity=%d breaks=%d irqs=%d\n\r",
+			port->no, port->irq, port->stats.bytes_in, port->stats.bytes_out, port->stats.dropped,
+			port->stats.overruns, port->stats.framing, port->stats.parity, port->stats.breaks,
+			port->stats.irqs);
+		if (port->flow == UART_FLOW_XONXOFF)
+			kconsole_printf("       xonxoff: xoffs=%d xons=%d throttled=%d stopped=%d tx_dropped=%d\n\r",
+				port->stats.xoffs, port->stats.xons, port->rx_throttled, port->tx_stopped,
+				port->stats.tx_dropped);
+	}
+}
+
+
+static void kconsole_sched(int argc, char **argv)
+{
+	kIrqBottomBudget	*budget = getPendingIrqBudget();
+	kIrqBottomStats		*stats = getPendingIrqStats();
+
+	if (argc > 2 && kconsole_strcmp(argv[1], "events") == 0)
+		budget->maxEvents = kconsole_atoi(argv[2]);
+#ifdef vexpress_a9
+	else if (argc > 2 && kconsole_strcmp(argv[1], "us") == 0)
+		budget->maxCycles = (uint32_t)kclock_ns_to_cycles((uint64_t)kconsole_atoi(argv[2]) * 1000);
+#endif
+	kconsole_printf("pending bottoms: %d (max %d)\n\r", getNbPendingIrq(), MAX_NBR_PENDING_IRQ);
+	kconsole_printf("budget: events=%d cycles=%d (0 for no limit)\n\r", budget->maxEvents, budget->maxCycles);
+	kconsole_printf("passes=%d exhausted=%d bottoms=%d max-bottoms=%d max-cycles=%d\n\r",
+		stats->nbPasses, stats->nbExhausted, stats->nbEvents, stats->maxEvents, stats->maxCycles);
+}
+
+
+#ifdef vexpress_a9
+static void kconsole_timer(int argc, char **argv)
+{
+	uint32_t		load, counter, control;
+	struct ktimer_stats	stats;
+	uint64_t		deadline;
+
+	timer_get_state(&load, &counter, &control);
+	kconsole_printf("timer: load=0x%x counter=0x%x control=0x%x\n\r", load, counter, control);
+	kconsole_printf("global timer: 0x%llx cycles, %llu ns\n\r", cycles(), ktime_get_ns());
+
+	ktimer_get_stats(&stats);
+	deadline = ktimer_next_deadline();
+	kconsole_printf("wheel: jiffies=%llu pending=%d added=%d canceled=%d expired=%d cascaded=%d ticks=%d saved=%d\n\r",
+		jiffies(), stats.nbPending, stats.nbAdded, stats.nbCanceled, stats.nbExpired,
+		stats.nbCascaded, stats.nbTicks, stats.nbSaved);
+	if (deadline != KTIMER_NO_DEADLINE)
+		kconsole_printf("next deadline: jiffy %llu\n\r", deadline);
+#ifdef CONFIG_TICKLESS
+	kconsole_printf("tickless: idles=%d stops=%d\n\r", stats.nbIdles, stats.nbIdleStops);
+#endif
+}
+
+
+static void kconsole_events(int argc, char **argv)
+{
+	struct kevent_stats	stats;
+	struct kcoro_stats	coros;
+
+	kevent_get_stats(&stats);
+	kconsole_printf("events: queued=%d (max %d) posted=%d delayed=%d dispatched=%d canceled=%d\n\r",
+		stats.nbQueued, stats.maxQueued, stats.nbPosted, stats.nbDelayed,
+		stats.nbDispatched, stats.nbCanceled);
+	kconsole_printf("pool: free=%d/%d empty=%d\n\r", stats.nbPoolFree, KEVENT_POOL_SIZE, stats.nbPoolEmpty);
+	kcoro_get_stats(&coros);
+	kconsole_printf("coroutines: alive=%d started=%d resumes=%d blocks=%d exited=%d (%d bytes each)\n\r",
+		coros.nbAlive, coros.nbStarted, coros.nbResumes, coros.nbBlocks, coros.nbExited, sizeof(struct kcoro));
+}
+
+
+static void kconsole_threads(int argc, char **argv)
+{
+	static const char	*states[] = {"ready", "running", "exited", "waiting", "throttled"};
+	struct kthread_stats	stats;
+	struct kvfp_stats	vfp;
+	struct kthread		*thread;
+
+	for (thread=kthread_list(); thread; thread=thread->all)
+	{
+		kconsole_printf("%d %-16s %-9s switches=%d preemptions=%d\n\r", thread->id, thread->name,
+			states[thread->state], thread->nbSwitches, thread->nbPreemptions);
+		if (thread->edf)
+			kconsole_printf("  edf period=%lluus budget=%lluus deadline=%lluus jobs=%d misses=%d throttles=%d\n\r",
+				kclock_cycles_to_ns(thread->edfParams.period) / 1000,
+				kclock_cycles_to_ns(thread->edfParams.budget) / 1000,
+				kclock_cycles_to_ns(thread->edfParams.deadline) / 1000,
+				thread->edfParams.nbJobs, thread->edfParams.nbMisses, thread->edfParams.nbThrottles);
+	}
+	kthread_get_stats(&stats);
+	kconsole_printf("edf load=%d/%d rejected=%d\n\r", stats.edfLoad, KTHREAD_EDF_LOAD_ONE, stats.nbEdfRejected);
+	kconsole_printf("switches=%d preemptions=%d yields=%d\n\r",
+		stats.nbSwitches, stats.nbPreemptions, stats.nbYields);
+	if (stats.nbSwitches)
+		kconsole_printf("switch cost: avg=%llu min=%d max=%d cycles\n\r",
+			stats.switchCycles / stats.nbSwitches, stats.minSwitchCycles, stats.maxSwitchCycles);
+	kvfp_get_stats(&vfp);
+	kconsole_printf("vfp: traps=%d saves=%d restores=%d\n\r", vfp.nbTraps, vfp.nbSaves, vfp.nbRestores);
+}
+
+
+/**
+ * The processor time of the threads (see kthread.h), in microseconds per mode,
+ * and their share of the busy time (all but idle) since boot.
+ */
+static void kconsole_ps(int argc, char **argv)
+{
+	static const char	*states[] = {"ready", "running", "exited", "waiting", "throttled"};
+	uint64_t		cycles[KTHREAD_NB_MODES];
+	uint64_t		busy, total = 0;
+	struct kthread		*thread;
+
+	for (thread=kthread_list(); thread; thread=thread->all)
+		if (kthread_times(thread->id, cycles))
+			total += cycles[KTHREAD_MODE_KERNEL] + cycles[KTHREAD_MODE_USER] + cycles[KTHREAD_MODE_IRQ];
+	kconsole_printf("id name             state        user(us)   kernel(us)      irq(us)     idle(us)  busy\n\r");
+	for (thread=kthread_list(); thread; thread=thread->all)
+	{
+		if (!kthread_times(thread->id, cycles))
+			continue;
+		busy = cycles[KTHREAD_MODE_KERNEL] + cycles[KTHREAD_MODE_USER] + cycles[KTHREAD_MODE_IRQ];
+		busy = total ? busy * 1000 / total : 0;
+		kconsole_printf("%-2d %-16s %-9s %12llu %12llu %12llu %12llu %3d.%d%%\n\r", thread->id, thread->name,
+			states[thread->state],
+			kclock_cycles_to_ns(cycles[KTHREAD_MODE_USER]) / 1000,
+			kclock_cycles_to_ns(cycles[KTHREAD_MODE_KERNEL]) / 1000,
+			kclock_cycles_to_ns(cycles[KTHREAD_MODE_IRQ]) / 1000,
+			kclock_cycles_to_ns(cycles[KTHREAD_MODE_IDLE]) / 1000,
+			(uint32_t)busy / 10, (uint32_t)busy % 10);
+	}
+}
+
+
+#ifdef CONFIG_TRACE
+static void kconsole_trace(int argc, char **argv)
+{
+	uint32_t cpu;
+
+	if (argc < 2)
+	{
+		kconsole_printf("tracing: %s\n\r", ktraceEnabled ? "on" : "off");
+		for (cpu=0; cpu<KTRACE_NB_CPUS; cpu++)
+			kconsole_printf("  cpu%d: %d records (%d written)\n\r", cpu, ktrace_nb_records(cpu),
+				ktraceRings[cpu].head);
+	}
+	else if (kconsole_strcmp(argv[1], "start") == 0)
+		ktrace_start();
+	else if (kconsole_strcmp(argv[1], "stop") == 0)
+		ktrace_stop();
+	else if (kconsole_strcmp(argv[1], "stream") == 0)
+		ktrace_stream();
+	else
+		kconsole_printf("usage: trace [start | stop | stream]\n\r");
+}
+#endif
+
+
+static void kconsole_idle(int argc, char **argv)
+{
+	struct kidle_stats stats;
+
+	if (argc > 2 && kconsole_strcmp(argv[1], "max") == 0)
+		kidle_set_max_spin((uint64_t)kconsole_atoi(argv[2]) * 1000);
+	kidle_get_stats(&stats);
+	kconsole_printf("window=%lluns max=%lluns inter-arrival=%lluns arrivals=%d\n\r",
+		kclock_cycles_to_ns(stats.window), kclock_cycles_to_ns(stats.maxWindow),
+		kclock_cycles_to_ns(stats.avgGap), stats.nbArrivals);
+	kconsole_printf("spin hits=%d misses=%d sleeps=%d spun=%lluus\n\r",
+		stats.nbSpinHits, stats.nbSpinMisses, stats.nbSleeps, kclock_cycles_to_ns(stats.spinCycles) / 1000);
+}
+
+
+static void kconsole_stacks(int argc, char **argv)
+{
+	struct kstack	*stack;
+	uint32_t	used;
+
+	for (stack=kstack_list(); stack; stack=stack->next)
+	{
+		used = kstack_high_water(stack);
+		kconsole_printf("%-16s %-5s size=%d high-water=%d (%d%%)%s\n\r", stack->name,
+			stack->pooled ? "pool" : "fixed", stack->size, used, used * 100 / stack->size,
+			kstack_check(stack) ? " OVERFLOWED" : "");
+	}
+#ifdef CONFIG_MMU
+	kconsole_printf("guard pages: unmapped\n\r");
+#else
+	kconsole_printf("guard pages: pattern, checked\n\r");
+#endif
+}
+
+
+/**
+ * Throughput benchmark of the work events: a batch of events, each spinning for
+ * a fixed number of iterations, spawned on the boot processor; the last one to
+ * complete records the end of the batch.
+ */
+#define KCONSOLE_BENCH_MAX_EVENTS	128
+#define KCONSOLE_BENCH_SPINS		20000
+
+static struct
+{
+	struct kevent		events[KCONSOLE_BENCH_MAX_EVENTS];
+	volatile uint32_t	remaining;
+	uint32_t		nbEvents;
+	uint64_t		start;
+	uint64_t		end;
+} consoleBench;
+
+
+static void kconsole_bench_event(struct kevent *event, void *arg)
+{
+	volatile uint32_t	i;
+	uint32_t		remaining;
+
+	for (i=0; i<KCONSOLE_BENCH_SPINS; i++)
+		;
+	do
+		remaining = consoleBench.remaining;
+	while (!ksmp_cas(&consoleBench.remaining, remaining, remaining - 1));
+	if (remaining == 1)
+		consoleBench.end = ktime_get_ns();
+}
+
+
+static void kconsole_smp(int argc, char **argv)
+{
+	struct ksmp_stats		stats;
+	struct kevent_work_stats	work;
+	uint32_t			cpu, i;
+	uint64_t			elapsed;
+
+	if (argc > 2 && kconsole_strcmp(argv[1], "bench") == 0)
+	{
+		if (consoleBench.remaining)
+		{
+			kconsole_printf("bench running, %d events left\n\r", consoleBench.remaining);
+			return;
+		}
+		consoleBench.nbEvents = kconsole_atoi(argv[2]);
+		if (consoleBench.nbEvents > KCONSOLE_BENCH_MAX_EVENTS)
+			consoleBench.nbEvents = KCONSOLE_BENCH_MAX_EVENTS;
+		consoleBench.remaining	= consoleBench.nbEvents;
+		consoleBench.end	= 0;
+		consoleBench.start	= ktime_get_ns();
+		for (i=0; i<consoleBench.nbEvents; i++)
+		{
+			kevent_setup(&consoleBench.events[i], kconsole_bench_event, NULL);
+			kevent_spawn(&consoleBench.events[i]);
+		}
+		kconsole_printf("bench: %d events spawned, type smp for the result\n\r", consoleBench.nbEvents);
+		return;
+	}
+
+	ksmp_get_stats(&stats);
+	kconsole_printf("processors: %d online=0x%x idle=0x%x\n\r", stats.nbCpus, stats.online, stats.idle);
+	for (cpu=0; cpu<KSMP_NB_CPUS; cpu++)
+	{
+		if (!(stats.online & (1 << cpu)))
+			continue;
+		kevent_get_work_stats(cpu, &work);
+		kconsole_printf("  cpu%d spawned=%d executed=%d stolen=%d overflows=%d wakeups=%d sleeps=%d\n\r",
+			cpu, work.nbSpawned, work.nbExecuted, work.nbStolen, work.nbOverflows,
+			stats.nbWakeups[cpu], stats.nbSleeps[cpu]);
+	}
+	if (consoleBench.nbEvents && consoleBench.remaining == 0 && consoleBench.end > consoleBench.start)
+	{
+		elapsed = consoleBench.end - consoleBench.start;
+		kconsole_printf("bench: %d events in %lluus, %llu events/s\n\r", consoleBench.nbEvents,
+			elapsed / 1000, (uint64_t)consoleBench.nbEvents * NSEC_PER_SEC / elapsed);
+	}
+}
+
+
+static void kconsole_write(const char *line, uint32_t length, void *arg)
+{
+	uart_port_write(consoleOut, (const unsigned char*)line, length);
+}
+
+
+static void kconsole_prof(int argc, char **argv)
+{
+	uint32_t cpu;
+
+	if (argc < 2)
+	{
+		kconsole_printf("profiler: hz=%d\n\r", kprof_hz());
+		for (cpu=0; cpu<KPROF_NB_CPUS; cpu++)
+			kconsole_printf("  cpu%d: %d samples\n\r", cpu, kprof_nb_samples(cpu));
+	}
+	else if (kconsole_strcmp(argv[1], "start") == 0)
+		kprof_start(argc > 2 ? kconsole_atoi(argv[2]) : KPROF_DEFAULT_HZ);
+	else if (kconsole_strcmp(argv[1], "stop") == 0)
+		kprof_stop();
+	else if (kconsole_strcmp(argv[1], "dump") == 0)
+		kprof_dump(kconsole_write, NULL);
+	else if (kconsole_strcmp(argv[1], "stream") == 0)
+		kprof_stream();
+	else
+		kconsole_printf("usage: prof [start [hz] | stop | dump | stream]\n\r");
+}
+
+
+#ifdef CONFIG_PROBES
+static void kconsole_probes(int argc, char **argv)
+{
+	struct kprobe	*probe;
+	uint32_t	i;
+
+	if (argc > 1 && kconsole_strcmp(argv[1], "reset") == 0)
+	{
+		kprobe_reset();
+		return;
+	}
+	for (probe=kprobe_list(); probe; probe=probe->next)
+	{
+		if (probe->count == 0)
+			continue;
+		kconsole_printf("%s: count=%d cycles=%llu avg=%llu max=%d\n\r", probe->name, probe->count,
+			probe->cycles, probe->cycles / probe->count, probe->maxCycles);
+		for (i=0; i<KPMU_NB_EVENTS; i++)
+			kconsole_printf("    %s=%llu", kpmu_event_name(i), probe->events[i]);
+		kconsole_printf("\n\r");
+	}
+}
+#endif
+
+
+#ifdef CONFIG_LATENCY_WATCHDOG
+static void kconsole_latency(int argc, char **argv)
+{
+	static const char	*kinds[KLATENCY_NB_KINDS] = {"top", "bottom", "timer"};
+	struct klatency_record	record;
+	uint32_t		age;
+
+	if (argc > 1 && kconsole_strcmp(argv[1], "reset") == 0)
+	{
+		klatency_reset();
+		return;
+	}
+	kconsole_printf("over budget: %d (budgets: top=%dns bottom=%dns timer=%dns)\n\r", klatency_nb_violations(),
+		KLATENCY_TOP_BUDGET_NS, KLATENCY_BOTTOM_BUDGET_NS, KLATENCY_TIMER_BUDGET_NS);
+	for (age=0; klatency_get_record(age, &record); age++)
+		kconsole_printf("  %s irq=%d handler=0x%x duration=%lluns pc=0x%x\n\r", kinds[record.kind], record.irq,
+			(uint32_t)record.handler, kclock_cycles_to_ns(record.duration), record.pc);
+}
+#endif
+#endif
+
+
+
+
+/**
+ * Initialize the console on the given ports, which must be opened.
+ * The console becomes the consumer of the input port.
+ */
+void kconsole_init(struct uart_port *in, struct uart_port *out)
+{
+	consoleIn		= in;
+	consoleOut		= out;
+	consoleLineLength	= 0;
+
+	kconsole_register("help",	"list the commands",			kconsole_help);
+	kconsole_register("mem",	"malloc/free statistics",		kconsole_mem);
+	kconsole_register("irq",	"IRQ counts and latency histograms",	kconsole_irq);
+	kconsole_register("uart",	"UART ports statistics",		kconsole_uart);
+	kconsole_register("sched",	"bottom runner state [events n|us n]",	kconsole_sched);
+#ifdef vexpress_a9
+	kconsole_register("timer",	"timer and timing wheel state",		kconsole_timer);
+	kconsole_register("events",	"event scheduler and coroutines",	kconsole_events);
+	kconsole_register("threads",	"kernel threads and switch cost",	kconsole_threads);
+	kconsole_register("ps",		"processor time of the threads",	kconsole_ps);
+#ifdef CONFIG_TRACE
+	kconsole_register("trace",	"event tracing [start | stop | stream]",	kconsole_trace);
+#endif
+	kconsole_register("idle",	"idle governor state [max us]",		kconsole_idle);
+	kconsole_register("stacks",	"stack high water marks and overflows",	kconsole_stacks);
+	kconsole_register("smp",	"processors and work events [bench n]",	kconsole_smp);
+	kconsole_register("prof",	"sampling profiler",			kconsole_prof);
+#ifdef CONFIG_LATENCY_WATCHDOG
+	kconsole_register("latency",	"handlers over budget, or reset them",	kconsole_latency);
+#endif
+#ifdef CONFIG_PROBES
+	kconsole_register("probes",	"hot path probes (PMU), or reset them",	kconsole_probes);
+#endif
+#endif
+
+	uart_port_bind(consoleIn, kconsole_receive, NULL);
+	uart_port_puts(consoleOut, (const unsigned char*)"\n\rKernel console, type help\n\r" KCONSOLE_PROMPT);
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) SID LAKHDAR Riyane.
+ *
+ * This code is a patch to the code implemented by Pr Olivier 
+ * Gruber during the Advanced Operating System cours.
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Classpath; see the file COPYING.  If not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA.
+ *
+ */
+
+#ifndef K_CONSOLE_H
+#define K_CONSOLE_H
+
+#include "board.h"
+#include "pl011.h"
+
+
+
+
+#define KCONSOLE_LINE_SIZE		80	// Max length of a command line
+#define KCONSOLE_OUT_SIZE		256	// Max length of one formatted output
+#define KCONSOLE_MAX_ARGS		8	// Max number of words on a command line
+#define KCONSOLE_MAX_COMMANDS		24	// Max number of registered commands
+#define KCONSOLE_PROMPT			"osa> "
+
+
+/**
+ * A console command gets the words of the command line,
+ * the first one being the command name.
+ */
+typedef void (*kConsoleCommand)(int argc, char **argv);
+
+
+typedef struct K_CONSOLE_ENTRY
+{
+	const char	*name;
+	const char	*help;
+	kConsoleCommand	command;
+} kConsoleEntry;
+
+
+
+
+
+
+void	kconsole_init		(struct uart_port *in, struct uart_port *out);
+int	kconsole_register	(const char *name, const char *help, kConsoleCommand command);
+void	kconsole_printf		(const char *fmt, ...);
+
+
+
+#endif
@@ -0,0 +1,172 @@
+#include "kcoro.h"
+
+
+static struct kcoro_stats kcoroStats;
+
+
+
+
+/**
+ * Reaction of the event of a coroutine: resume it.
+ */
+static void kcoro_run(struct kevent *event, void *arg)
+{
+	struct kcoro *coro = (struct kcoro*)arg;
+
+	kcoroStats.nbResumes++;
+	if (coro->func(coro) == KCORO_EXITED)
+	{
+		coro->state = KCORO_IDLE;
+		kcoroStats.nbAlive--;
+		kcoroStats.nbExited++;
+	}
+}
+
+
+/**
+ * Start the coroutine, its function is first called from its event, at the given priority.
+ */
+void kcoro_start(struct kcoro *coro, kcoro_func_t func, uint32_t priority)
+{
+	kevent_setup(&coro->event, kcoro_run, coro);
+	coro->func	= func;
+	coro->next	= NULL;
+	coro->resume	= 0;
+	coro->state	= KCORO_READY;
+	kcoroStats.nbStarted++;
+	kcoroStats.nbAlive++;
+	kevent_post(&coro->event, priority);
+}
+
+
+/**
+ * Post the event of the coroutine, at its priority.
+ */
+void kcoro_wake(struct kcoro *coro)
+{
+	coro->state = KCORO_READY;
+	kevent_post(&coro->event, coro->event.priority);
+}
+
+
+void kcoro_waitq_init(struct kcoro_waitq *waitq)
+{
+	waitq->head = NULL;
+	waitq->tail = NULL;
+}
+
+
+/**
+ * Queue the coroutine in the wait queue, from KCORO_AWAIT, with the interrupts
+ * disabled since the check of the condition: restore them.
+ */
+void kcoro_block(struct kcoro *coro, struct kcoro_waitq *waitq)
+{
+	coro->state	= KCORO_BLOCKED;
+	coro->next	= NULL;
+	if (waitq->tail)
+		waitq->tail->next = coro;
+	else
+		waitq->head = coro;
+	waitq->tail = coro;
+	kcoroStats.nbBlocks++;
+	if (coro->enabled)
+		arm_enable_interrupts();
+}
+
+
+/**
+ * Wake up all the coroutines of the wait queue, to check their condition again.
+ * May be called from a top half.
+ */
+void kcoro_signal(struct kcoro_waitq *waitq)
+{
+	struct kcoro	*coro, *next;
+	int		enabled = arm_disable_interrupts();
+
+	coro		= waitq->head;
+	waitq->head	= NULL;
+	waitq->tail	= NULL;
+	for (; coro; coro=next)
+	{
+		next		= coro->next;
+		coro->next	= NULL;
+		kcoro_wake(coro);
+	}
+	if (enabled)
+		arm_enable_interrupts();
+}
+
+
+/**
+ * Consumer of a UART port (see uart_port_bind), signaling the wait queue
+ * given as argument when bytes have been received.
+ */
+void kcoro_uart_consumer(struct uart_port *port, void *arg)
+{
+	kcoro_signal((struct kcoro_waitq*)arg);
+}
+
+
+/**
+ * Link the count buffers of the given size, contiguous from buffers, in the pool.
+ */
+void kcoro_pool_init(struct kcoro_pool *pool, void *buffers, uint32_t size, uint32_t count)
+{
+	uint8_t *buffer = (uint8_t*)buffers + size * count;
+
+	pool->free	= NULL;
+	pool->nbFree	= 0;
+	pool->nbEmpty	= 0;
+	kcoro_waitq_init(&pool->waitq);
+	while (count--)
+	{
+		buffer -= size;
+		kcoro_pool_put(pool, buffer);
+	}
+}
+
+
+/**
+ * A free buffer, NULL if the pool is empty (see KCORO_ALLOC to wait for one).
+ */
+void* kcoro_pool_get(struct kcoro_pool *pool)
+{
+	void	*buffer;
+	int	enabled = arm_disable_interrupts();
+
+	buffer = pool->free;
+	if (buffer)
+	{
+		pool->free = *(void**)buffer;
+		pool->nbFree--;
+	}
+	else
+		pool->nbEmpty++;
+	if (enabled)
+		arm_enable_interrupts();
+	return buffer;
+}
+
+
+/**
+ * Put the buffer back in the pool, and wake up the coroutines waiting for one.
+ * May be called from a top half.
+ */
+void kcoro_pool_put(struct kcoro_pool *pool, void *buffer)
+{
+	int enabled = arm_disable_interrupts();
+
+	*(void**)buffer	= pool->free;
+	pool->free	= buffer;
+	pool->nbFree++;
+	kcoro_signal(&pool->waitq);
+	if (enabled)
+		arm_enable_interrupts();
+}
+
+
+void kcoro_get_stats(struct kcoro_stats *stats)
+{
+	*stats = kcoroStats;
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) SID LAKHDAR Riyane.
+ *
+ * This code is a patch to the code implemented by Pr Olivier 
+ * Gruber during the Advanced Operating System cours.
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Classpath; see the file COPYING.  If not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA.
+ *
+ */
+
+
+#ifndef KCORO_H
+#define KCORO_H
+
+#include "board.h"
+#include "gic.h"
+#include "kevent.h"
+#include "pl011.h"
+
+
+/**
+ * Stackless coroutines (protothreads), run by the event scheduler.
+ *
+ * A coroutine is a function called again and again by its event: each call resumes
+ * it where it last waited, through a switch on the line it waited at (Duff's device),
+ * and returns KCORO_WAITING when it waits again, or KCORO_EXITED when done.
+ * The saved state is the resume line, a few bytes: a coroutine costs the size of
+ * its struct kcoro, and no stack, so that a driver or a service may run thousands
+ * of concurrent activities.
+ *
+ * Since the stack is not kept, the local variables of the coroutine function do not
+ * survive a wait: the state of an activity lives in the structure embedding its
+ * struct kcoro (see container_of). For the same reason, a coroutine may only wait
+ * in its own function, not in the functions it calls, and must not use a switch
+ * across a wait.
+ *
+ *	static int echo(struct kcoro *coro)
+ *	{
+ *		struct echo *echo = container_of(coro, coro, struct echo);
+ *
+ *		KCORO_BEGIN(coro);
+ *		for (;;)
+ *		{
+ *			KCORO_AWAIT(coro, &echo->rx, uart_port_getc(echo->port, &echo->c));
+ *			uart_port_putc(echo->port, echo->c);
+ *			KCORO_SLEEP(coro, 1000000);
+ *		}
+ *		KCORO_END(coro);
+ *	}
+ *
+ * A coroutine waits on:
+ *   - a condition, with a wait queue signaled when the condition may have changed,
+ *     by a bottom, an event, or a top half (KCORO_AWAIT, kcoro_signal);
+ *     kcoro_uart_consumer signals a wait queue when bytes are received on a UART port,
+ *   - a delay, through the timer of its event (KCORO_SLEEP),
+ *   - its next turn, behind the events already posted (KCORO_YIELD),
+ *   - a free buffer of a pool, signaled when a buffer is put back (KCORO_ALLOC).
+ */
+#define KCORO_WAITING		0
+#define KCORO_EXITED		1
+
+#define KCORO_IDLE		0	// Not started, or exited
+#define KCORO_READY		1	// Its event is posted or delayed
+#define KCORO_BLOCKED		2	// In a wait queue
+
+
+struct kcoro;
+typedef int (*kcoro_func_t)(struct kcoro *coro);
+
+struct kcoro
+{
+	struct kevent		event;		// Resumes the coroutine
+	kcoro_func_t		func;
+	struct kcoro		*next;		// In a wait queue
+	uint16_t		resume;		// Line to resume at, 0 at the start
+	uint8_t			state;
+	uint8_t			enabled;	// Interrupts were enabled, while a condition is checked
+};
+
+struct kcoro_waitq
+{
+	struct kcoro		*head;
+	struct kcoro		*tail;
+};
+
+/**
+ * A pool of fixed size buffers (at least a pointer), the free ones linked
+ * through their first word.
+ */
+struct kcoro_pool
+{
+	void			*free;
+	struct kcoro_waitq	waitq;		// Waiting for a free buffer
+	uint32_t		nbFree;
+	uint32_t		nbEmpty;	// Allocations that found the pool empty
+};
+
+struct kcoro_stats
+{
+	uint32_t		nbAlive;	// Started, not exited yet
+	uint32_t		nbStarted;
+	uint32_t		nbResumes;
+	uint32_t		nbBlocks;
+	uint32_t		nbExited;
+};
+
+
+
+
+void	kcoro_start		(struct kcoro *coro, kcoro_func_t func, uint32_t priority);
+void	kcoro_wake		(struct kcoro *coro);
+void	kcoro_waitq_init	(struct kcoro_waitq *waitq);
+void	kcoro_block		(struct kcoro *coro, struct kcoro_waitq *waitq);
+void	kcoro_signal		(struct kcoro_waitq *waitq);
+void	kcoro_uart_consumer	(struct uart_port *port, void *arg);
+void	kcoro_pool_init		(struct kcoro_pool *pool, void *buffers, uint32_t size, uint32_t count);
+void*	kcoro_pool_get		(struct kcoro_pool *pool);
+void	kcoro_pool_put		(struct kcoro_pool *pool, void *buffer);
+void	kcoro_get_stats		(struct kcoro_stats *stats);
+
+
+#define KCORO_BEGIN(coro)							\
+	switch ((coro)->resume) { case 0:
+
+#define KCORO_END(coro)								\
+	} (coro)->resume = 0; return KCORO_EXITED
+
+#define KCORO_EXIT(coro)							\
+	do { (coro)->resume = 0; return KCORO_EXITED; } while (0)
+
+/**
+ * Wait until the condition is true, signaled through the wait queue.
+ * The condition is checked with the interrupts disabled, so that a signal
+ * from a top half cannot be lost between the check and the block.
+ */
+#define KCORO_AWAIT(coro, waitq, cond)						\
+	do {									\
+		(coro)->resume = __LINE__; case __LINE__:			\
+		(coro)->enabled = arm_disable_interrupts();			\
+		if (!(cond))							\
+		{								\
+			kcoro_block((coro), (waitq));				\
+			return KCORO_WAITING;					\
+		}								\
+		if ((coro)->enabled)						\
+			arm_enable_interrupts();				\
+	} while (0)
+
+/**
+ * Wait for the given delay, in nanoseconds.
+ */
+#define KCORO_SLEEP(coro, ns)							\
+	do {									\
+		(coro)->resume = __LINE__;					\
+		(coro)->state = KCORO_READY;					\
+		kevent_post_delayed(&(coro)->event, (coro)->event.priority, (ns));	\
+		return KCORO_WAITING; case __LINE__:;				\
+	} while (0)
+
+/**
+ * Wait for a free buffer of the pool, assigned to the given lvalue.
+ */
+#define KCORO_ALLOC(coro, pool, buffer)						\
+	KCORO_AWAIT((coro), &(pool)->waitq, ((buffer) = kcoro_pool_get(pool)) != NULL)
+
+/**
+ * Let the events already posted run, then resume.
+ */
+#define KCORO_YIELD(coro)							\
+	do {									\
+		(coro)->resume = __LINE__;					\
+		kcoro_wake(coro);						\
+		return KCORO_WAITING; case __LINE__:;				\
+	} while (0)
+
+
+
+#endif
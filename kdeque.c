@@ -0,0 +1,86 @@
+#include "kdeque.h"
+#include "ksmp.h"
+
+
+
+
+void kdeque_init(struct kdeque *deque)
+{
+	deque->top	= 0;
+	deque->bottom	= 0;
+}
+
+
+/**
+ * Owner: push the item at the bottom. Returns false if the deque is full.
+ * The item is written before bottom is published to the thieves.
+ */
+int kdeque_push(struct kdeque *deque, void *item)
+{
+	uint32_t bottom = deque->bottom;
+
+	if (bottom - deque->top >= KDEQUE_SIZE)
+		return 0;
+	deque->items[bottom & KDEQUE_MASK] = item;
+	ksmp_dmb();
+	deque->bottom = bottom + 1;
+	return 1;
+}
+
+
+/**
+ * Owner: pop the item at the bottom, NULL if the deque is empty.
+ * bottom is decremented before top is read (full barrier), so that a thief either
+ * sees the decremented bottom, or has already taken top: only the last item is raced for.
+ */
+void* kdeque_pop(struct kdeque *deque)
+{
+	uint32_t	bottom = deque->bottom - 1;
+	uint32_t	top;
+	void		*item;
+
+	deque->bottom = bottom;
+	ksmp_dmb();
+	top = deque->top;
+	if ((int32_t)(bottom - top) < 0)
+	{
+		deque->bottom = bottom + 1;
+		return NULL;
+	}
+	item = deque->items[bottom & KDEQUE_MASK];
+	if (bottom != top)
+		return item;
+	if (!ksmp_cas(&deque->top, top, top + 1))
+		item = NULL;
+	deque->bottom = bottom + 1;
+	return item;
+}
+
+
+/**
+ * Thief: take the item at the top, NULL if the deque is empty or if the item
+ * was taken meanwhile by the owner or another thief.
+ */
+void* kdeque_steal(struct kdeque *deque)
+{
+	uint32_t	top = deque->top;
+	uint32_t	bottom;
+	void		*item;
+
+	ksmp_dmb();
+	bottom = deque->bottom;
+	if ((int32_t)(bottom - top) <= 0)
+		return NULL;
+	item = deque->items[top & KDEQUE_MASK];
+	if (!ksmp_cas(&deque->top, top, top + 1))
+		return NULL;
+	return item;
+}
+
+
+uint32_t kdeque_size(struct kdeque *deque)
+{
+	int32_t size = (int32_t)(deque->bottom - deque->top);
+
+	return size > 0 ? size : 0;
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) SID LAKHDAR Riyane.
+ *
+ * This code is a patch to the code implemented by Pr Olivier 
+ * Gruber during the Advanced Operating System cours.
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Classpath; see the file COPYING.  If not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA.
+ *
+ */
+
+
+#ifndef KDEQUE_H
+#define KDEQUE_H
+
+#include "board.h"
+
+
+/**
+ * Chase-Lev work-stealing deque, of fixed capacity.
+ *
+ * The owner processor pushes and pops at the bottom (LIFO), the other processors
+ * steal at the top (FIFO). The owner only synchronizes with the thieves when the
+ * deque has a single element left: the owner and the thieves then race to increment
+ * top with a compare-and-swap (LDREX/STREX), the loser gets nothing.
+ * The owner operations must not be interleaved with each other: they are done with
+ * the interrupts disabled on the owner processor.
+ *
+ * top and bottom only increase (modulo 2^32): the number of elements is bottom - top.
+ */
+#define KDEQUE_SIZE		256	// must be a power of two
+#define KDEQUE_MASK		(KDEQUE_SIZE - 1)
+
+struct kdeque
+{
+	volatile uint32_t	top;		// Next to steal
+	volatile uint32_t	bottom;		// Next to push
+	void * volatile		items[KDEQUE_SIZE];
+};
+
+
+
+
+void		kdeque_init		(struct kdeque *deque);
+int		kdeque_push		(struct kdeque *deque, void *item);
+void*		kdeque_pop		(struct kdeque *deque);
+void*		kdeque_steal		(struct kdeque *deque);
+uint32_t	kdeque_size		(struct kdeque *deque);
+
+
+
+#endif
@@ -0,0 +1,366 @@
+#include "kevent.h"
+#include "gic.h"
+#include "ktrace.h"
+
+
+/**
+ * The FIFOs of the posted events, one per priority, and the bitmap of the non empty ones.
+ */
+static struct
+{
+	struct kevent		*heads[KEVENT_NB_PRIORITIES];
+	struct kevent		*tails[KEVENT_NB_PRIORITIES];
+	uint32_t		bitmap;
+	struct kevent		*pool;
+	struct kevent_stats	stats;
+} keventQueues;
+
+static struct kevent	keventPool[KEVENT_POOL_SIZE];
+
+/**
+ * The pool is shared by the processors: the work events go back to it
+ * on the processor that ran them.
+ */
+static volatile uint32_t	keventPoolLock;
+
+/**
+ * The work-stealing deques, one per processor.
+ */
+static struct
+{
+	struct kdeque			deque;
+	struct kevent_work_stats	stats;
+} keventWork[KSMP_NB_CPUS];
+
+
+
+
+void kevent_init()
+{
+	uint32_t i;
+
+	keventQueues.pool = NULL;
+	for (i=0; i<KEVENT_POOL_SIZE; i++)
+	{
+		keventPool[i].state	= KEVENT_FREE;
+		keventPool[i].pooled	= 1;
+		keventPool[i].next	= keventQueues.pool;
+		keventQueues.pool	= &keventPool[i];
+	}
+	keventQueues.stats.nbPoolFree = KEVENT_POOL_SIZE;
+	for (i=0; i<KSMP_NB_CPUS; i++)
+		kdeque_init(&keventWork[i].deque);
+}
+
+
+/**
+ * Timer of a delayed event: post the event at its priority.
+ */
+static void kevent_expired(struct ktimer *timer, void *arg)
+{
+	struct kevent *event = (struct kevent*)arg;
+
+	event->state = KEVENT_IDLE;
+	kevent_post(event, event->priority);
+}
+
+
+void kevent_setup(struct kevent *event, kevent_func_t func, void *arg)
+{
+	event->next	= NULL;
+	event->func	= func;
+	event->arg	= arg;
+	event->priority	= KEVENT_PRIORITY_DEFAULT;
+	event->state	= KEVENT_IDLE;
+	event->pooled	= 0;
+	ktimer_setup(&event->timer, kevent_expired, event);
+}
+
+
+/**
+ * Draw an event from the pool, NULL if the pool is empty.
+ * The event goes back to the pool once its reaction has run, unless it is posted again.
+ */
+struct kevent* kevent_alloc(kevent_func_t func, void *arg)
+{
+	struct kevent	*event;
+	int		enabled = arm_disable_interrupts();
+
+	ksmp_lock(&keventPoolLock);
+	event = keventQueues.pool;
+	if (event)
+	{
+		keventQueues.pool = event->next;
+		keventQueues.stats.nbPoolFree--;
+	}
+	else
+		keventQueues.stats.nbPoolEmpty++;
+	ksmp_unlock(&keventPoolLock);
+	if (enabled)
+		arm_enable_interrupts();
+	if (event)
+	{
+		kevent_setup(event, func, arg);
+		event->pooled = 1;
+	}
+	return event;
+}
+
+
+/**
+ * Give back to the pool an event that is neither queued nor delayed.
+ */
+void kevent_free(struct kevent *event)
+{
+	int enabled = arm_disable_interrupts();
+
+	ksmp_lock(&keventPoolLock);
+	event->state		= KEVENT_FREE;
+	event->next		= keventQueues.pool;
+	keventQueues.pool	= event;
+	keventQueues.stats.nbPoolFree++;
+	ksmp_unlock(&keventPoolLock);
+	if (enabled)
+		arm_enable_interrupts();
+}
+
+
+/**
+ * Queue the event at the tail of the FIFO of the given priority, if it is not already queued.
+ * Posting a delayed event cancels its delay.
+ */
+void kevent_post(struct kevent *event, uint32_t priority)
+{
+	int enabled = arm_disable_interrupts();
+
+	if (event->state == KEVENT_DELAYED)
+	{
+		ktimer_cancel(&event->timer);
+		event->state = KEVENT_IDLE;
+	}
+	if (event->state != KEVENT_QUEUED)
+	{
+		if (priority >= KEVENT_NB_PRIORITIES)
+			priority = KEVENT_PRIORITY_LOW;
+		event->priority	= priority;
+		event->state	= KEVENT_QUEUED;
+		event->next	= NULL;
+		if (keventQueues.tails[priority])
+			keventQueues.tails[priority]->next = event;
+		else
+			keventQueues.heads[priority] = event;
+		keventQueues.tails[priority]	= event;
+		keventQueues.bitmap		|= 0x80000000 >> priority;
+		keventQueues.stats.nbPosted++;
+		if (++keventQueues.stats.nbQueued > keventQueues.stats.maxQueued)
+			keventQueues.stats.maxQueued = keventQueues.stats.nbQueued;
+	}
+	if (enabled)
+		arm_enable_interrupts();
+}
+
+
+/**
+ * Post the event at the given priority once the delay (in nanoseconds) has elapsed.
+ */
+void kevent_post_delayed(struct kevent *event, uint32_t priority, uint64_t delay)
+{
+	int enabled = arm_disable_interrupts();
+
+	if (event->state != KEVENT_QUEUED)
+	{
+		event->priority	= (priority < KEVENT_NB_PRIORITIES) ? priority : KEVENT_PRIORITY_LOW;
+		event->state	= KEVENT_DELAYED;
+		ktimer_add_ns(&event->timer, delay);
+		keventQueues.stats.nbDelayed++;
+	}
+	if (enabled)
+		arm_enable_interrupts();
+}
+
+
+/**
+ * Remove a queued event from its FIFO, in O(n) of the FIFO, or cancel its delay.
+ * Returns true if the event was queued or delayed.
+ */
+int kevent_cancel(struct kevent *event)
+{
+	struct kevent	**link, *prev = NULL;
+	int		enabled = arm_disable_interrupts();
+	int		canceled = 0;
+
+	if (event->state == KEVENT_DELAYED)
+	{
+		ktimer_cancel(&event->timer);
+		event->state	= KEVENT_IDLE;
+		canceled	= 1;
+	}
+	else if (event->state == KEVENT_QUEUED)
+	{
+		for (link=&keventQueues.heads[event->priority]; *link!=event; link=&(*link)->next)
+			prev = *link;
+		*link = event->next;
+		if (keventQueues.tails[event->priority] == event)
+			keventQueues.tails[event->priority] = prev;
+		if (keventQueues.heads[event->priority] == NULL)
+			keventQueues.bitmap &= ~(0x80000000 >> event->priority);
+		keventQueues.stats.nbQueued--;
+		event->state	= KEVENT_IDLE;
+		canceled	= 1;
+	}
+	if (canceled)
+		keventQueues.stats.nbCanceled++;
+	if (enabled)
+		arm_enable_interrupts();
+	return canceled;
+}
+
+
+/**
+ * Returns true if events are queued.
+ */
+int kevent_pending()
+{
+	return keventQueues.bitmap != 0;
+}
+
+
+/**
+ * Run the reaction of the first event of the highest priority, to completion,
+ * with the interrupts enabled. Returns false if there was no queued event.
+ */
+int kevent_dispatch()
+{
+	struct kevent	*event;
+	uint32_t	priority;
+	int		enabled = arm_disable_interrupts();
+
+	if (keventQueues.bitmap == 0)
+	{
+		if (enabled)
+			arm_enable_interrupts();
+		return 0;
+	}
+	priority	= __builtin_clz(keventQueues.bitmap);
+	event		= keventQueues.heads[priority];
+	keventQueues.heads[priority] = event->next;
+	if (event->next == NULL)
+	{
+		keventQueues.tails[priority] = NULL;
+		keventQueues.bitmap &= ~(0x80000000 >> priority);
+	}
+	keventQueues.stats.nbQueued--;
+	keventQueues.stats.nbDispatched++;
+	event->state = KEVENT_RUNNING;
+	arm_enable_interrupts();
+
+	TRACE_BEGIN(KTRACE_EVENT, event->func);
+	event->func(event, event->arg);
+	TRACE_END(KTRACE_EVENT, event->func);
+
+	arm_disable_interrupts();
+	if (event->state == KEVENT_RUNNING)
+	{
+		event->state = KEVENT_IDLE;
+		if (event->pooled)
+			kevent_free(event);
+	}
+	if (enabled)
+		arm_enable_interrupts();
+	return 1;
+}
+
+
+void kevent_get_stats(struct kevent_stats *stats)
+{
+	*stats = keventQueues.stats;
+}
+
+
+/**
+ * Push a work event on the deque of the current processor, and wake up an idle
+ * processor to steal it. Returns false if the deque is full.
+ */
+int kevent_spawn(struct kevent *event)
+{
+	struct kdeque	*deque;
+	uint32_t	cpu;
+	int		spawned;
+	int		enabled = arm_disable_interrupts();
+
+	cpu		= ksmp_cpu();
+	deque		= &keventWork[cpu].deque;
+	event->state	= KEVENT_QUEUED;
+	spawned		= kdeque_push(deque, event);
+	if (spawned)
+		keventWork[cpu].stats.nbSpawned++;
+	else
+	{
+		event->state = KEVENT_IDLE;
+		keventWork[cpu].stats.nbOverflows++;
+	}
+	if (enabled)
+		arm_enable_interrupts();
+	if (spawned)
+		ksmp_wakeup();
+	return spawned;
+}
+
+
+/**
+ * Run one work event, to completion: the newest of the deque of the current processor,
+ * or else the oldest of the deque of another one, visited round robin from the next
+ * processor. Returns false if there was no work to run.
+ */
+int kevent_work()
+{
+	struct kevent	*event;
+	uint32_t	cpu = ksmp_cpu();
+	uint32_t	i;
+	int		enabled = arm_disable_interrupts();
+
+	event = kdeque_pop(&keventWork[cpu].deque);
+	if (enabled)
+		arm_enable_interrupts();
+	for (i=1; event==NULL && i<KSMP_NB_CPUS; i++)
+	{
+		event = kdeque_steal(&keventWork[(cpu + i) & (KSMP_NB_CPUS - 1)].deque);
+		if (event)
+			keventWork[cpu].stats.nbStolen++;
+	}
+	if (event == NULL)
+		return 0;
+
+	keventWork[cpu].stats.nbExecuted++;
+	event->state = KEVENT_RUNNING;
+	TRACE_BEGIN(KTRACE_EVENT, event->func);
+	event->func(event, event->arg);
+	TRACE_END(KTRACE_EVENT, event->func);
+	if (event->state == KEVENT_RUNNING)
+	{
+		event->state = KEVENT_IDLE;
+		if (event->pooled)
+			kevent_free(event);
+	}
+	return 1;
+}
+
+
+/**
+ * Returns true if work events are queued on any processor.
+ */
+int kevent_work_pending()
+{
+	uint32_t i;
+
+	for (i=0; i<KSMP_NB_CPUS; i++)
+		if (kdeque_size(&keventWork[i].deque))
+			return 1;
+	return 0;
+}
+
+
+void kevent_get_work_stats(uint32_t cpu, struct kevent_work_stats *stats)
+{
+	*stats = keventWork[cpu & (KSMP_NB_CPUS - 1)].stats;
+}
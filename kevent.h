@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) SID LAKHDAR Riyane.
+ *
+ * This code is a patch to the code implemented by Pr Olivier 
+ * Gruber during the Advanced Operating System cours.
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Classpath; see the file COPYING.  If not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA.
+ *
+ */
+
+
+#ifndef KEVENT_H
+#define KEVENT_H
+
+#include "board.h"
+#include "ktimer.h"
+#include "ksmp.h"
+#include "kdeque.h"
+
+
+/**
+ * Run-to-completion event scheduler.
+ *
+ * An event is a reaction (function and argument) posted at a priority: the dispatcher
+ * runs the posted events one at a time, with the interrupts enabled, each to completion,
+ * the highest priority first and in posting order among equal priorities.
+ * There is one FIFO per priority, and a bitmap of the non empty FIFOs: the bit
+ * (31 - priority) is set when the FIFO of that priority is not empty, so that the
+ * highest priority to run is the count of leading zeros of the bitmap.
+ * Posting and dispatching are O(1), whatever the number of queued events.
+ *
+ * Events are either embedded in the structure they react for (kevent_setup),
+ * or drawn from a preallocated pool (kevent_alloc), rather than from kmalloc:
+ * a pool event goes back to the pool once its reaction has run, unless it was posted again.
+ * Posting does not allocate, it may be done from a top half.
+ *
+ * A delayed event is posted by its timer (see ktimer.h) once its delay has elapsed.
+ *
+ * Work events (kevent_spawn) are not prioritized: they go to the work-stealing deque
+ * (see kdeque.h) of the processor spawning them, which runs them in LIFO order, while
+ * the idle processors steal the oldest ones (see ksmp.h). A work event may run on
+ * any processor, it must not be spawned again before its reaction has started.
+ * Posted and delayed events only run on the boot processor.
+ */
+#define KEVENT_NB_PRIORITIES	32
+#define KEVENT_PRIORITY_HIGH	0
+#define KEVENT_PRIORITY_DEFAULT	16
+#define KEVENT_PRIORITY_LOW	(KEVENT_NB_PRIORITIES - 1)
+
+#define KEVENT_POOL_SIZE	64
+
+#define KEVENT_IDLE		0	// Neither queued nor delayed
+#define KEVENT_QUEUED		1	// In the FIFO of its priority
+#define KEVENT_DELAYED		2	// Its timer is pending
+#define KEVENT_RUNNING		3	// Its reaction is running
+#define KEVENT_FREE		4	// In the pool
+
+
+struct kevent;
+typedef void (*kevent_func_t)(struct kevent *event, void *arg);
+
+struct kevent
+{
+	struct kevent		*next;
+	kevent_func_t		func;
+	void			*arg;
+	struct ktimer		timer;		// For the delayed posts
+	uint8_t			priority;
+	uint8_t			state;
+	uint8_t			pooled;		// Drawn from the pool by kevent_alloc
+};
+
+struct kevent_stats
+{
+	uint32_t		nbQueued;	// Events currently queued
+	uint32_t		maxQueued;
+	uint32_t		nbPosted;
+	uint32_t		nbDelayed;
+	uint32_t		nbDispatched;
+	uint32_t		nbCanceled;
+	uint32_t		nbPoolFree;	// Events currently in the pool
+	uint32_t		nbPoolEmpty;	// Allocations failed on an empty pool
+};
+
+struct kevent_work_stats
+{
+	uint32_t		nbSpawned;	// Pushed on the deque of the processor
+	uint32_t		nbExecuted;
+	uint32_t		nbStolen;	// Executed, taken from the deque of another processor
+	uint32_t		nbOverflows;	// Spawns failed on a full deque
+};
+
+
+
+
+void		kevent_init		();
+void		kevent_setup		(struct kevent *event, kevent_func_t func, void *arg);
+struct kevent*	kevent_alloc		(kevent_func_t func, void *arg);
+void		kevent_free		(struct kevent *event);
+void		kevent_post		(struct kevent *event, uint32_t priority);
+void		kevent_post_delayed	(struct kevent *event, uint32_t priority, uint64_t delay);
+int		kevent_cancel		(struct kevent *event);
+int		kevent_pending		();
+int		kevent_dispatch		();
+void		kevent_get_stats	(struct kevent_stats *stats);
+int		kevent_spawn		(struct kevent *event);
+int		kevent_work		();
+int		kevent_work_pending	();
+void		kevent_get_work_stats	(uint32_t cpu, struct kevent_work_stats *stats);
+
+
+
+#endif
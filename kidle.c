@@ -0,0 +1,119 @@
+#include "kidle.h"
+#include "kclock.h"
+#include "kevent.h"
+#include "kirqPendingList.h"
+#include "kthread.h"
+
+
+extern void _arm_sleep(void);
+
+static struct
+{
+	uint64_t		lastArrival;
+	struct kidle_stats	stats;
+} kidle;
+
+
+
+
+void kidle_init()
+{
+	kidle.lastArrival		= cycles();
+	kidle.stats.maxWindow		= kclock_ns_to_cycles(KIDLE_MAX_SPIN_NS);
+	kidle.stats.avgGap		= kidle.stats.maxWindow * KIDLE_MAX_GAP_FACTOR;
+	kidle.stats.window		= 0;
+}
+
+
+/**
+ * Top half: an interrupt arrived, update the average inter-arrival time and the window.
+ * The gaps are clamped, so that the average recovers quickly after a long idle period.
+ */
+void kidle_arrival()
+{
+	uint64_t now = cycles();
+	uint64_t gap = now - kidle.lastArrival;
+	uint64_t maxGap = kidle.stats.maxWindow * KIDLE_MAX_GAP_FACTOR;
+
+	kidle.lastArrival = now;
+	if (gap > maxGap)
+		gap = maxGap;
+	kidle.stats.avgGap += (gap >> KIDLE_EWMA_SHIFT) - (kidle.stats.avgGap >> KIDLE_EWMA_SHIFT);
+	kidle.stats.nbArrivals++;
+
+	if (kidle.stats.avgGap * KIDLE_SPIN_FACTOR <= kidle.stats.maxWindow)
+		kidle.stats.window = kidle.stats.avgGap * KIDLE_SPIN_FACTOR;
+	else if (kidle.stats.avgGap <= kidle.stats.maxWindow)
+		kidle.stats.window = kidle.stats.maxWindow;
+	else
+		kidle.stats.window = 0;
+}
+
+
+static int kidle_work_pending()
+{
+	return getNbPendingIrq() != 0 || kevent_pending() || kevent_work_pending();
+}
+
+
+/**
+ * Spin for the current window, with the interrupts enabled, polling for work.
+ * Returns true if work arrived: the caller goes back to it instead of sleeping.
+ * The spin is accounted as idle time (see kthread.h).
+ */
+int kidle_spin()
+{
+	uint64_t	window = kidle.stats.window;
+	uint64_t	start, spun;
+	uint32_t	mode;
+	int		hit = 0;
+
+	if (window == 0)
+		return 0;
+	mode = kthread_mode_enter(KTHREAD_MODE_IDLE);
+	start = cycles();
+	do
+	{
+		spun = cycles() - start;
+		if (kidle_work_pending())
+		{
+			hit = 1;
+			break;
+		}
+	} while (spun < window);
+	if (hit)
+		kidle.stats.nbSpinHits++;
+	else
+		kidle.stats.nbSpinMisses++;
+	kidle.stats.spinCycles += spun;
+	kthread_mode_enter(mode);
+	return hit;
+}
+
+
+/**
+ * Wait for an interrupt, with the interrupts disabled (see the kmain loop),
+ * accounted as idle time.
+ */
+void kidle_sleep()
+{
+	uint32_t mode = kthread_mode_enter(KTHREAD_MODE_IDLE);
+
+	kidle.stats.nbSleeps++;
+	_arm_sleep();
+	kthread_mode_enter(mode);
+}
+
+
+void kidle_set_max_spin(uint64_t ns)
+{
+	kidle.stats.maxWindow = kclock_ns_to_cycles(ns);
+	if (kidle.stats.window > kidle.stats.maxWindow)
+		kidle.stats.window = kidle.stats.maxWindow;
+}
+
+
+void kidle_get_stats(struct kidle_stats *stats)
+{
+	*stats = kidle.stats;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) SID LAKHDAR Riyane.
+ *
+ * This code is a patch to the code implemented by Pr Olivier 
+ * Gruber during the Advanced Operating System cours.
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Classpath; see the file COPYING.  If not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA.
+ *
+ */
+
+
+#ifndef KIDLE_H
+#define KIDLE_H
+
+#include "board.h"
+
+
+/**
+ * Adaptive spin-then-sleep idle governor.
+ *
+ * Waking up from WFI costs latency, polling forever costs power: when the main loop
+ * has nothing left to do, it first spins for a window, polling for work (bottom halves,
+ * events), and only then waits for an interrupt.
+ * The window follows the recent inter-arrival time of the interrupts (an exponentially
+ * weighted moving average, updated by the top half): only the interrupts of the devices
+ * with bottom halves (UARTs, timer tick) count, not the profiler nor the watchdog,
+ * which bring no work to the main loop. Under bursty traffic, the next
+ * interrupt is expected within the window and is served at polling latency; when the
+ * interrupts are sparse, the average exceeds the maximum window and the processor
+ * goes to sleep at once.
+ */
+#define KIDLE_EWMA_SHIFT	3		// Weight of the last inter-arrival time: 1/8
+#define KIDLE_SPIN_FACTOR	2		// Window, in inter-arrival times
+#define KIDLE_MAX_SPIN_NS	100000		// 100us
+#define KIDLE_MAX_GAP_FACTOR	4		// Inter-arrival times clamped to this many maximum windows
+
+struct kidle_stats
+{
+	uint64_t		avgGap;		// Clocksource cycles between interrupts, moving average
+	uint64_t		window;		// Clocksource cycles of the next spin
+	uint64_t		maxWindow;
+	uint64_t		spinCycles;	// Total time spent spinning
+	uint32_t		nbArrivals;
+	uint32_t		nbSpinHits;	// Work arrived while spinning
+	uint32_t		nbSpinMisses;	// Spun for the whole window, then slept
+	uint32_t		nbSleeps;
+};
+
+
+
+
+void	kidle_init		();
+void	kidle_arrival		();
+int	kidle_spin		();
+void	kidle_sleep		();
+void	kidle_set_max_spin	(uint64_t ns);
+void	kidle_get_stats		(struct kidle_stats *stats);
+
+
+
+#endif
@@ -1,4 +1,9 @@
 #include "kirqPendingList.h"
+#ifdef vexpress_a9
+#include "gic.h"
+#else
+#include "pl190.h"
+#endif
 
 
 
@@ -11,6 +16,13 @@ kIrqPendingList *irqPendingList;
 int		nbPendingIrqRequest;
 
 
+/**
+ * Budget and statistics of the passes of the bottom runner
+ */
+static kIrqBottomBudget	irqBottomBudget = {IRQ_BOTTOM_BUDGET_EVENTS, IRQ_BOTTOM_BUDGET_CYCLES};
+static kIrqBottomStats	irqBottomStats;
+
+
 
 /**
  * Initialize the structures that contain the pending IRQ requests
@@ -50,6 +62,15 @@ for (j=0; j<nbArg; j++)
 }
 
 
+/**
+ * Return the number of pending IRQ (that have not been handeled yet).
+ */
+int getNbPendingIrq()
+{
+	return nbPendingIrqRequest;
+}
+
+
 char isFullPendingIrqList()
 {
 	return (nbPendingIrqRequest >= MAX_NBR_PENDING_IRQ);
@@ -57,31 +78,82 @@ char isFullPendingIrqList()
 
 
 /**
- * Put a pending IRQ into the parameter pendingEntry.   Remove the returned entry from the local list.
+ * Put the pending IRQ of highest priority (the oldest one among equal priorities) into the
+ * parameter pendingEntry.   Remove the returned entry from the local list.
  * Return 0 if the local list contains no pending IRQ, and 1 otherwise.
+ * Called from the main loop with the interrupts enabled, while the interrupt handler
+ * pushes on the head of the list: the interrupts are disabled from the scan to the free.
  */
 unsigned int getAndRemovePendingIrq(kIrqPendingEntry *pendingEntry)
 {
+	int enabled;
+
 	if (nbPendingIrqRequest <= 0)
 		return 0;
 
+	enabled = arm_disable_interrupts();
 	kIrqPendingList *tmpIrqPendingList	= irqPendingList;
 	kIrqPendingList *prevIrqPendingList	= NULL;
+	kIrqPendingList *bestIrqPendingList	= irqPendingList;
+	kIrqPendingList *prevBestIrqPendingList	= NULL;
 
-	while(tmpIrqPendingList->next != NULL)
+	// The list is ordered from the newest to the oldest request
+	while(tmpIrqPendingList != NULL)
 	{
+		if (tmpIrqPendingList->entry.priority <= bestIrqPendingList->entry.priority)
+		{
+			bestIrqPendingList	= tmpIrqPendingList;
+			prevBestIrqPendingList	= prevIrqPendingList;
+		}
 		prevIrqPendingList	= tmpIrqPendingList;
 		tmpIrqPendingList	= tmpIrqPendingList->next;
 	}
 
-	*pendingEntry = tmpIrqPendingList->entry;
-	kfree(tmpIrqPendingList);
-	nbPendingIrqRequest --;
-	if (prevIrqPendingList != NULL)
-		prevIrqPendingList->next = NULL;
+	*pendingEntry = bestIrqPendingList->entry;
+	if (prevBestIrqPendingList != NULL)
+		prevBestIrqPendingList->next = bestIrqPendingList->next;
 	else
-		irqPendingList = NULL;
+		irqPendingList = bestIrqPendingList->next;
+	kfree(bestIrqPendingList);
+	nbPendingIrqRequest --;
+	if (enabled)
+		arm_enable_interrupts();
 
 	return 1;
 }
 
+
+/**
+ * Return the budget of a pass of the bottom runner, that can be modified.
+ */
+kIrqBottomBudget* getPendingIrqBudget()
+{
+	return &irqBottomBudget;
+}
+
+
+/**
+ * Return the statistics of the passes of the bottom runner.
+ */
+kIrqBottomStats* getPendingIrqStats()
+{
+	return &irqBottomStats;
+}
+
+
+/**
+ * Account for a pass of the bottom runner that ran nbEvents bottoms in the given cycles,
+ * exhausted being true if the pass ended on its budget with bottoms still pending.
+ */
+void accountPendingIrqPass(uint32_t nbEvents, uint32_t cycles, char exhausted)
+{
+	irqBottomStats.nbPasses ++;
+	irqBottomStats.nbEvents += nbEvents;
+	if (exhausted)
+		irqBottomStats.nbExhausted ++;
+	if (nbEvents > irqBottomStats.maxEvents)
+		irqBottomStats.maxEvents = nbEvents;
+	if (cycles > irqBottomStats.maxCycles)
+		irqBottomStats.maxCycles = cycles;
+}
+
@@ -29,6 +29,7 @@
 
 #include "kmem.h"
 #include "board.h"
+#include "pl011.h"
 
 #include <stdarg.h>
 
@@ -38,16 +39,35 @@
 #define MAX_NBR_PENDING_IRQ	3
 
 
+/**
+ * Priorities of the bottoms: the lower runs first, in the order of request for equal priorities.
+ * The timer bottom runs the timer callbacks, so that a burst of bottoms does not delay them.
+ */
+#define IRQ_PRIORITY_TIMER	0
+#define IRQ_PRIORITY_UART	1
+#define IRQ_PRIORITY_DEFAULT	2
+
+
+/**
+ * Default budget of a pass of the bottom runner: at most that many bottoms,
+ * and at most that many cycles of the global timer (0 for no limit).
+ * When the budget is exhausted, the runner returns to the idle loop with bottoms still pending.
+ */
+#define IRQ_BOTTOM_BUDGET_EVENTS	8
+#define IRQ_BOTTOM_BUDGET_CYCLES	0
+
+
 typedef struct __attribute ((packed)) K_IRQ_PENDING_ENTRY
 {
 	uint32_t irqId;
+	uint32_t priority;
+	uint32_t stamp;		// Time at which the top requested the bottom (in ticks)
 	union __attribute ((packed))
 	{
 		struct __attribute ((packed))
 		{
-			char	receivedChar;
-			void	(*handler)(char);
-		}uart0;
+			struct uart_port	*port;
+		}uart;
 	};
 } kIrqPendingEntry;
 
@@ -59,6 +79,23 @@ typedef struct __attribute ((packed)) K_IRQ_PENDING_LIST
 } kIrqPendingList;
 
 
+typedef struct K_IRQ_BOTTOM_BUDGET
+{
+	uint32_t	maxEvents;	// Bottoms per pass, 0 for no limit
+	uint32_t	maxCycles;	// Global timer cycles per pass, 0 for no limit
+} kIrqBottomBudget;
+
+
+typedef struct K_IRQ_BOTTOM_STATS
+{
+	uint32_t	nbPasses;	// Passes of the bottom runner
+	uint32_t	nbExhausted;	// Passes that ended on the budget, with bottoms still pending
+	uint32_t	nbEvents;	// Bottoms run
+	uint32_t	maxEvents;	// Most bottoms run in a pass
+	uint32_t	maxCycles;	// Longest pass, in global timer cycles
+} kIrqBottomStats;
+
+
 
 
 
@@ -67,6 +104,10 @@ void		initIrqPendingList		();
 void		addPendingIrq			(kIrqPendingEntry entry);
 char		isFullPendingIrqList		();
 unsigned int	getAndRemovePendingIrq		(kIrqPendingEntry *pendingEntry);
+int		getNbPendingIrq			();
+kIrqBottomBudget*getPendingIrqBudget		();
+kIrqBottomStats*getPendingIrqStats		();
+void		accountPendingIrqPass		(uint32_t nbEvents, uint32_t cycles, char exhausted);
 
 
 
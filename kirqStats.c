@@ -0,0 +1,65 @@
+#include "kirqStats.h"
+
+
+
+
+/**
+ * Statistics of all the IRQs, indexed by IRQ number
+ */
+static kIrqStats irqStats[CORTEX_A9_NIRQS];
+
+
+
+/**
+ * Return the index of the histogram bucket for the given latency (in ticks)
+ */
+uint32_t irqStatsBucketOf(uint32_t latency)
+{
+	uint32_t bucket;
+
+	if (latency == 0)
+		return 0;
+	bucket = 32 - __builtin_clz(latency);
+	if (bucket >= IRQ_STATS_NB_BUCKETS)
+		bucket = IRQ_STATS_NB_BUCKETS - 1;
+	return bucket;
+}
+
+
+/**
+ * Account for the execution of the top handler of the given IRQ
+ */
+void irqStatsTop(uint32_t irqId)
+{
+	if (irqId < CORTEX_A9_NIRQS)
+		irqStats[irqId].nbTops ++;
+}
+
+
+/**
+ * Account for the execution of the bottom handler of the given IRQ,
+ * the latency being the number of ticks since its top has requested it.
+ */
+void irqStatsBottom(uint32_t irqId, uint32_t latency)
+{
+	kIrqStats *stats;
+
+	if (irqId >= CORTEX_A9_NIRQS)
+		return;
+	stats = &irqStats[irqId];
+	stats->nbBottoms ++;
+	stats->latency[irqStatsBucketOf(latency)] ++;
+	if (latency > stats->maxLatency)
+		stats->maxLatency = latency;
+}
+
+
+/**
+ * Return the statistics of the given IRQ, or NULL if the IRQ number is invalid
+ */
+kIrqStats* getIrqStats(uint32_t irqId)
+{
+	if (irqId >= CORTEX_A9_NIRQS)
+		return NULL;
+	return &irqStats[irqId];
+}
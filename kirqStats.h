@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) SID LAKHDAR Riyane.
+ *
+ * This code is a patch to the code implemented by Pr Olivier 
+ * Gruber during the Advanced Operating System cours.
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Classpath; see the file COPYING.  If not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA.
+ *
+ */
+
+#ifndef K_IRQ_STATS_H
+#define K_IRQ_STATS_H
+
+#include "board.h"
+
+
+
+
+/**
+ * Number of buckets of the latency histograms.
+ * The bucket i counts the latencies in [2^(i-1), 2^i[ ticks,
+ * the last bucket also counts all the larger latencies.
+ */
+#define IRQ_STATS_NB_BUCKETS	20
+
+
+/**
+ * Statistics of one IRQ: number of tops and bottoms executed,
+ * and histogram of the latency between a top and its bottom.
+ */
+typedef struct K_IRQ_STATS
+{
+	uint32_t	nbTops;
+	uint32_t	nbBottoms;
+	uint32_t	maxLatency;
+	uint32_t	latency[IRQ_STATS_NB_BUCKETS];
+} kIrqStats;
+
+
+
+
+
+
+void		irqStatsTop			(uint32_t irqId);
+void		irqStatsBottom			(uint32_t irqId, uint32_t latency);
+kIrqStats*	getIrqStats			(uint32_t irqId);
+uint32_t	irqStatsBucketOf		(uint32_t latency);
+
+
+
+#endif
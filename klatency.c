@@ -0,0 +1,175 @@
+#include "klatency.h"
+#include "kclock.h"
+#include "timer.h"
+#include "gid.h"
+
+
+static struct klatency_section	*klatencyCurrent;
+static uint32_t			klatencyBudgets[KLATENCY_NB_KINDS][CORTEX_A9_NIRQS];
+
+static struct klatency_record	klatencyRecords[KLATENCY_NB_RECORDS];
+static uint32_t			klatencyHead;		// Number of records ever written
+static uint32_t			klatencyNbViolations;
+
+
+
+
+/**
+ * Arm the watchdog timer to catch the given section at the end of its budget.
+ */
+static void klatency_arm(struct klatency_section *section)
+{
+	uint32_t elapsed;
+
+	elapsed = gtimer_read_low() - section->start;
+	if (elapsed >= section->budget)
+		timer_watchdog_arm_oneshot(1);
+	else
+		timer_watchdog_arm_oneshot(section->budget - elapsed);
+}
+
+
+static void klatency_disarm()
+{
+	timer_watchdog_disarm();
+}
+
+
+
+
+/**
+ * Default budgets, for all the IRQs.
+ */
+void klatency_init()
+{
+	uint32_t irq;
+
+	for (irq=0; irq<CORTEX_A9_NIRQS; irq++)
+	{
+		klatency_set_budget(KLATENCY_TOP,	irq, KLATENCY_TOP_BUDGET_NS);
+		klatency_set_budget(KLATENCY_BOTTOM,	irq, KLATENCY_BOTTOM_BUDGET_NS);
+		klatency_set_budget(KLATENCY_TIMER,	irq, KLATENCY_TIMER_BUDGET_NS);
+	}
+	klatencyCurrent = NULL;
+	cortex_a9_gid_enable_irq(TIMER_WATCHDOG_IRQ);
+}
+
+
+void klatency_set_budget(uint32_t kind, uint32_t irq, uint32_t ns)
+{
+	klatencyBudgets[kind][irq] = (uint32_t)kclock_ns_to_cycles(ns);
+}
+
+
+/**
+ * Budget in cycles.
+ */
+uint32_t klatency_get_budget(uint32_t kind, uint32_t irq)
+{
+	return klatencyBudgets[kind][irq];
+}
+
+
+/**
+ * Sections nest (a top half may interrupt a bottom half, a timer callback runs
+ * within the timer bottom half): the current sections form a stack.
+ */
+void klatency_begin(struct klatency_section *section, uint32_t kind, uint32_t irq, void *handler)
+{
+	section->kind		= kind;
+	section->irq		= irq;
+	section->handler	= handler;
+	section->pc		= 0;
+	section->budget		= klatencyBudgets[kind][irq];
+	section->outer		= klatencyCurrent;
+	klatencyCurrent		= section;
+	section->start		= gtimer_read_low();
+	if (kind != KLATENCY_TOP)
+		klatency_arm(section);
+}
+
+
+/**
+ * Close the section, and record it if it went over budget.
+ * The watchdog timer is given back to the enclosing section, if it is watched.
+ */
+void klatency_end(struct klatency_section *section)
+{
+	uint32_t		duration = gtimer_read_low() - section->start;
+	struct klatency_record	*record;
+	int			enabled;
+
+	klatencyCurrent = section->outer;
+	if (section->kind != KLATENCY_TOP)
+	{
+		if (section->outer && section->outer->kind != KLATENCY_TOP)
+			klatency_arm(section->outer);
+		else
+			klatency_disarm();
+	}
+	if (duration <= section->budget)
+		return;
+
+	enabled = arm_disable_interrupts();
+	record			= &klatencyRecords[klatencyHead & (KLATENCY_NB_RECORDS - 1)];
+	record->handler		= section->handler;
+	record->duration	= duration;
+	record->stamp		= section->start + duration;
+	record->pc		= section->pc;
+	record->irq		= section->irq;
+	record->kind		= section->kind;
+	klatencyHead++;
+	klatencyNbViolations++;
+	if (enabled)
+		arm_enable_interrupts();
+}
+
+
+/**
+ * Called on the watchdog timer interrupt (top half, with the frame of the interrupted code):
+ * catch the PC of the current section, if it is past its budget.
+ * The watchdog timer is acknowledged by the caller.
+ */
+void klatency_watchdog(struct irq_frame *frame)
+{
+	struct klatency_section *section;
+
+	for (section=klatencyCurrent; section; section=section->outer)
+	{
+		if (section->kind == KLATENCY_TOP)
+			continue;
+		if (section->pc == 0 && gtimer_read_low() - section->start >= section->budget)
+			section->pc = frame->pc;
+		break;
+	}
+}
+
+
+uint32_t klatency_nb_violations()
+{
+	return klatencyNbViolations;
+}
+
+
+/**
+ * Get a record, by age (0 for the most recent one).
+ * Returns 0 if there is no such record (never written, or overwritten).
+ */
+int klatency_get_record(uint32_t age, struct klatency_record *record)
+{
+	if (age >= klatencyHead || age >= KLATENCY_NB_RECORDS)
+		return 0;
+	*record = klatencyRecords[(klatencyHead - 1 - age) & (KLATENCY_NB_RECORDS - 1)];
+	return 1;
+}
+
+
+void klatency_reset()
+{
+	int enabled = arm_disable_interrupts();
+
+	klatencyHead		= 0;
+	klatencyNbViolations	= 0;
+	if (enabled)
+		arm_enable_interrupts();
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) SID LAKHDAR Riyane.
+ *
+ * This code is a patch to the code implemented by Pr Olivier 
+ * Gruber during the Advanced Operating System cours.
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Classpath; see the file COPYING.  If not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA.
+ *
+ */
+
+
+#ifndef KLATENCY_H
+#define KLATENCY_H
+
+#include "board.h"
+#include "gic.h"
+
+
+/**
+ * Latency watchdog.
+ * Each IRQ top half, bottom half and timer callback runs within a section,
+ * timed with the clocksource cycles, and given a time budget (per kind of handler and per IRQ).
+ * A section that exceeds its budget leaves a record in a diagnostic ring:
+ * handler, duration, IRQ and, for the handlers running with the interrupts enabled,
+ * the PC where the handler was when its budget expired.
+ *
+ * That PC is caught by the watchdog timer (IRQ 30, see timer.h), armed as a one-shot
+ * for the budget of the bottom half or timer callback.
+ *
+ * Without CONFIG_LATENCY_WATCHDOG, the LATENCY_BEGIN/LATENCY_END macros expand to nothing.
+ */
+#define KLATENCY_TOP		0
+#define KLATENCY_BOTTOM		1
+#define KLATENCY_TIMER		2
+#define KLATENCY_NB_KINDS	3
+
+#define KLATENCY_NB_RECORDS	64	// must be a power of two
+
+#define KLATENCY_TOP_BUDGET_NS		20000
+#define KLATENCY_BOTTOM_BUDGET_NS	500000
+#define KLATENCY_TIMER_BUDGET_NS	200000
+
+struct klatency_section
+{
+	uint32_t			start;
+	uint32_t			budget;		// Cycles
+	void				*handler;
+	uint32_t			irq;
+	uint32_t			pc;		// Caught by the watchdog, 0 if none
+	uint8_t				kind;
+	struct klatency_section		*outer;
+};
+
+struct klatency_record
+{
+	void				*handler;
+	uint32_t			duration;	// Cycles
+	uint32_t			stamp;		// Cycles (low 32 bits), at the end of the section
+	uint32_t			pc;
+	uint16_t			irq;
+	uint8_t				kind;
+};
+
+
+
+
+void		klatency_init		();
+void		klatency_set_budget	(uint32_t kind, uint32_t irq, uint32_t ns);
+uint32_t	klatency_get_budget	(uint32_t kind, uint32_t irq);
+void		klatency_begin		(struct klatency_section *section, uint32_t kind, uint32_t irq, void *handler);
+void		klatency_end		(struct klatency_section *section);
+void		klatency_watchdog	(struct irq_frame *frame);
+uint32_t	klatency_nb_violations	();
+int		klatency_get_record	(uint32_t age, struct klatency_record *record);
+void		klatency_reset		();
+
+
+#ifdef CONFIG_LATENCY_WATCHDOG
+
+#define LATENCY_BEGIN(sectionName, kind, irq, handler)				\
+	struct klatency_section __latency_##sectionName;			\
+	klatency_begin(&__latency_##sectionName, kind, irq, (void*)(handler))
+
+#define LATENCY_END(sectionName)						\
+	klatency_end(&__latency_##sectionName)
+
+#else
+
+#define LATENCY_BEGIN(sectionName, kind, irq, handler)
+#define LATENCY_END(sectionName)
+
+#endif
+
+
+
+#endif
@@ -29,7 +29,31 @@
 #endif
 #include "kmem.h"
 #include "kirqPendingList.h"
+#include "sp804.h"
+#include "kprof.h"
+#ifdef vexpress_a9
 #include "timer.h"
+#include "gtimer.h"
+#include "kclock.h"
+#include "ktimer.h"
+#include "kevent.h"
+#include "kcoro.h"
+#include "ksmp.h"
+#include "kthread.h"
+#include "kstack.h"
+#include "kmmu.h"
+#include "kidle.h"
+#include "ktrace.h"
+#include "kvfp.h"
+#include "kpmu.h"
+#include "kprobe.h"
+#include "klatency.h"
+#endif
+#include "kirqStats.h"
+#include "kconsole.h"
+#ifdef CONFIG_BENCH_KPRINTF
+#include "kbench.h"
+#endif
 
 #define ECHO
 #define ECHO_ZZZ
@@ -37,8 +61,8 @@
 
 extern void _arm_sleep(void);
 
-struct pl011_uart* stdin;
-struct pl011_uart* stdout;
+struct uart_port* stdin;
+struct uart_port* stdout;
 
 
 
@@ -61,6 +85,177 @@ struct pl011_uart* stdout;
  */
 #ifdef vexpress_a9
 
+#ifndef CONFIG_CONSOLE
+/**
+ * Echo of the stdin port on stdout, as a coroutine (see kcoro.h): the consumer
+ * of the stdin port signals the wait queue of the received characters.
+ */
+static struct
+{
+	struct kcoro		coro;
+	struct kcoro_waitq	rx;
+	struct uart_port	*in;
+	struct uart_port	*out;
+	unsigned char		c;
+} uartEcho;
+
+static int uart_echo(struct kcoro *coro)
+{
+	KCORO_BEGIN(coro);
+	for (;;)
+	{
+		KCORO_AWAIT(coro, &uartEcho.rx, uart_port_getc(uartEcho.in, &uartEcho.c));
+		if (uartEcho.c == 13)
+			uart_port_write(uartEcho.out, (const unsigned char*)"\r\n", 2);
+		else
+			uart_port_putc(uartEcho.out, uartEcho.c);
+	}
+	KCORO_END(coro);
+}
+#endif
+
+
+#ifdef CONFIG_TEST_TIMER
+static struct ktimer testTimer;
+
+/**
+ * Test of the timing wheel: a one second timer, re-armed each time it expires.
+ */
+static void test_timer_expired(struct ktimer *timer, void *arg)
+{
+	kprintf("Test timer expired at %llu ns\n\r", ktime_get_ns());
+	ktimer_add_ns(timer, NSEC_PER_SEC);
+}
+#endif
+
+
+#ifdef CONFIG_TEST_COROS
+/**
+ * Test of the coroutines: a producer sends numbered messages to a consumer,
+ * through a mailbox, in buffers of a pool of two. The producer waits for a free
+ * buffer and yields after each message, the consumer waits for the mailbox and
+ * sleeps before freeing each buffer, so both wait, and are woken up, in turn.
+ */
+#define TEST_COROS_NB_MSGS	8
+
+struct test_msg
+{
+	struct test_msg		*next;
+	uint32_t		seq;
+};
+
+static struct
+{
+	struct kcoro		producer;
+	struct kcoro		consumer;
+	struct kcoro_pool	pool;
+	struct kcoro_waitq	mailbox;
+	struct test_msg		buffers[2];
+	struct test_msg		*head;
+	struct test_msg		*tail;
+	struct test_msg		*sent;
+	struct test_msg		*received;
+	uint32_t		nbSent;
+	uint32_t		nbReceived;
+	uint32_t		nbErrors;
+} testCoros;
+
+static struct test_msg *test_coros_receive()
+{
+	struct test_msg *msg = testCoros.head;
+
+	if (msg)
+	{
+		testCoros.head = msg->next;
+		if (testCoros.head == NULL)
+			testCoros.tail = NULL;
+	}
+	return msg;
+}
+
+static int test_coros_producer(struct kcoro *coro)
+{
+	KCORO_BEGIN(coro);
+	while (testCoros.nbSent < TEST_COROS_NB_MSGS)
+	{
+		KCORO_ALLOC(coro, &testCoros.pool, testCoros.sent);
+		testCoros.sent->seq	= testCoros.nbSent++;
+		testCoros.sent->next	= NULL;
+		if (testCoros.tail)
+			testCoros.tail->next = testCoros.sent;
+		else
+			testCoros.head = testCoros.sent;
+		testCoros.tail = testCoros.sent;
+		kcoro_signal(&testCoros.mailbox);
+		KCORO_YIELD(coro);
+	}
+	KCORO_END(coro);
+}
+
+static int test_coros_consumer(struct kcoro *coro)
+{
+	struct kcoro_stats stats;
+
+	KCORO_BEGIN(coro);
+	while (testCoros.nbReceived < TEST_COROS_NB_MSGS)
+	{
+		KCORO_AWAIT(coro, &testCoros.mailbox, (testCoros.received = test_coros_receive()) != NULL);
+		if (testCoros.received->seq != testCoros.nbReceived++)
+			testCoros.nbErrors++;
+		KCORO_SLEEP(coro, 10000000);
+		kcoro_pool_put(&testCoros.pool, testCoros.received);
+	}
+	if (testCoros.pool.nbFree != 2)
+		testCoros.nbErrors++;
+	kcoro_get_stats(&stats);
+	kprintf("Coroutine test: %d messages, %d waits for a buffer, %d blocks, %s\n\r",
+		testCoros.nbReceived, testCoros.pool.nbEmpty, stats.nbBlocks,
+		testCoros.nbErrors ? "FAILED" : "ok");
+	KCORO_END(coro);
+}
+
+static void test_coros()
+{
+	kcoro_pool_init(&testCoros.pool, testCoros.buffers, sizeof(struct test_msg), 2);
+	kcoro_waitq_init(&testCoros.mailbox);
+	kcoro_start(&testCoros.consumer, test_coros_consumer, KEVENT_PRIORITY_DEFAULT);
+	kcoro_start(&testCoros.producer, test_coros_producer, KEVENT_PRIORITY_DEFAULT);
+}
+#endif
+
+
+#ifdef CONFIG_TEST_THREADS
+/**
+ * Test of the kernel threads: spin forever, relying on the preemption.
+ */
+static void test_thread(void *arg)
+{
+	volatile uint32_t count = 0;
+
+	for (;;)
+		count++;
+}
+
+
+/**
+ * Test of the EDF threads: a periodic job spinning for a millisecond,
+ * with a 2ms budget every 20ms, co-hosted with the spinning threads.
+ */
+static void test_edf_thread(void *arg)
+{
+	uint64_t start;
+
+	for (;;)
+	{
+		start = ktime_get_ns();
+		while (ktime_get_ns() - start < 1000000)
+			;
+		kthread_edf_wait();
+	}
+}
+#endif
+
+
 /**
  * This is a simple initialization to get interrupts from the UART0 (stdin).
  * Enable interrupts requires multiple steps on the VExpress board:
@@ -74,17 +269,77 @@ void irq_init()
 {
 	cortex_a9_gid_init();
 	// cortex_a9_gid_dump_state();
-	uart_send_string(stdout, "GID initialized.\n\r");
+	uart_send_string(stdout->uart, "GID initialized.\n\r");
 	cortex_a9_gic_init();
 	// cortex_a9_gic_dump_state();
-	uart_send_string(stdout, "GIC initialized.\n\r");
+	uart_send_string(stdout->uart, "GIC initialized.\n\r");
 
 	/*
-	* Enable the RX interrupt on the UART0, our standard input (stdin).
-	* We do not need to enable any other interrupts, but many others exist.
+	* Open the UART0 port, our standard input (stdin), with its receive interrupts.
+	* The characters are echoed by the consumer bound to the port, on stdout.
+	* The stdout port is also opened, when it is another UART, so that it sends
+	* through its TX ring and interrupt.
 	*/
-	uart_enable_irqs(stdin,UART_IMSC_RXIM);
-	cortex_a9_gid_enable_irq(UART0_IRQ);
+	uart_port_open(stdin, UART_IFLS(UART_IFLS_1_2, UART_IFLS_1_8));
+#ifdef CONFIG_UART_XONXOFF
+	uart_port_flow(stdin, UART_FLOW_XONXOFF);
+#endif
+	cortex_a9_gid_enable_irq(stdin->irq);
+	if (stdout != stdin)
+	{
+		uart_port_open(stdout, UART_IFLS(UART_IFLS_1_2, UART_IFLS_1_8));
+		cortex_a9_gid_enable_irq(stdout->irq);
+	}
+
+	/*
+	* Stop the SP804 dual timers, and enable the interrupt of the first one,
+	* used by the sampling profiler.
+	*/
+	sp804_init(SP804_0);
+	sp804_init(SP804_1);
+	cortex_a9_gid_enable_irq(KPROF_TIMER_IRQ);
+#ifdef CONFIG_CONSOLE
+	kconsole_init(stdin, stdout);
+#else
+	uartEcho.in	= stdin;
+	uartEcho.out	= stdout;
+	kcoro_waitq_init(&uartEcho.rx);
+	uart_port_bind(stdin, kcoro_uart_consumer, &uartEcho.rx);
+#endif
+}
+
+
+/**
+ * Run the bottom of the given pending IRQ.
+ */
+static void handlPendingIrq(kIrqPendingEntry *pendingIrq)
+{
+	irqStatsBottom(pendingIrq->irqId, gtimer_read_low() - pendingIrq->stamp);
+	TRACE_BEGIN(KTRACE_BOTTOM, pendingIrq->irqId);
+	switch(pendingIrq->irqId)
+	{
+	case UART0_IRQ:
+	case UART1_IRQ:
+	case UART2_IRQ:
+	case UART3_IRQ:
+	{
+		LATENCY_BEGIN(bottom, KLATENCY_BOTTOM, pendingIrq->irqId, pendingIrq->uart.port->consumer);
+		uart_port_bottom(pendingIrq->uart.port);
+		LATENCY_END(bottom);
+		break;
+	}
+	case TIMER_PRIVATE_IRQ:
+	{
+		LATENCY_BEGIN(bottom, KLATENCY_BOTTOM, pendingIrq->irqId, ktimer_bottom);
+		ktimer_bottom();
+		LATENCY_END(bottom);
+		break;
+	}
+	default:
+		panic(666, "Unknown IRQ type\n\r");
+		break; // Useless cause panic calls halt (but used by the compiler)
+	}
+	TRACE_END(KTRACE_BOTTOM, pendingIrq->irqId);
 }
 
 
@@ -93,36 +348,39 @@ void irq_init()
  */
 void handlAllPendingIrq()
 {
-uint32_t timerCounter = arm_mmio_read32(cortex_a9_peripheral_base() + ARM_PWT_BASE_OFFSET,TIMER_OFF_WATCHDOG_REGISTER_COUNTER);
-kprintf("+++ counter = 0x%x\n", timerCounter);
 	kIrqPendingEntry pendingIrq;
 
 	while(getAndRemovePendingIrq(&pendingIrq))
-	{
-		switch(pendingIrq.irqId)
-		{
-		case UART0_IRQ:
-			pendingIrq.uart0.handler(pendingIrq.uart0.receivedChar);
-			break;
-		default:
-			panic(666, "Unknown IRQ type\n\r");
-			break; // Useless cause panic calls halt (but used by the compiler)
-		}
-	}
+		handlPendingIrq(&pendingIrq);
 }
 
 
-void handler_uart0_IRQ(char c)
+/**
+ * Handle the pending IRQ by priority, within the budget of a pass of the bottom runner.
+ * Return 1 if the budget was exhausted with bottoms still pending, 0 otherwise.
+ */
+int handlBudgetedPendingIrq()
 {
-	if (c == 13)
-	{
-		uart_send(stdout, '\r');
-		uart_send(stdout, '\n');
-	}
-	else
+	kIrqBottomBudget	*budget = getPendingIrqBudget();
+	kIrqPendingEntry	pendingIrq;
+	uint32_t		start = gtimer_read_low();
+	uint32_t		nbEvents = 0;
+	char			exhausted = 0;
+
+	while(getAndRemovePendingIrq(&pendingIrq))
 	{
-		uart_send(stdout, c);
+		handlPendingIrq(&pendingIrq);
+		nbEvents ++;
+		if ((budget->maxEvents != 0 && nbEvents >= budget->maxEvents) ||
+		    (budget->maxCycles != 0 && gtimer_read_low() - start >= budget->maxCycles))
+		{
+			exhausted = (getNbPendingIrq() != 0);
+			break;
+		}
 	}
+	if (nbEvents != 0)
+		accountPendingIrqPass(nbEvents, gtimer_read_low() - start, exhausted);
+	return exhausted;
 }
 
 /**
@@ -131,14 +389,28 @@ void handler_uart0_IRQ(char c)
  * handled by a different handler. See assembly setup in gic.s.
  */
 //#define ECHO_IRQ
-void irq_handler(void)
+void irq_handler(struct irq_frame* frame)
 {
 	irq_id_t irq = 0;
 	cpu_id_t cpu = 0;
-	char c = '.';
+	struct uart_port* port;
+	uint32_t mode;
 
 	arm_disable_interrupts();
 
+#ifdef CONFIG_SMP
+	/*
+	 * The secondary processors only take the wake up SGI (see ksmp.c):
+	 * the bottoms, timers and threads belong to the boot processor.
+	 */
+	if (ksmp_cpu() != 0)
+	{
+		ksmp_irq();
+		arm_enable_interrupts();
+		return;
+	}
+#endif
+
 	/*
 	 * If the list of pending IRQ is full, execute all of them before to cache the current.
 	 * The reason for that is that for the time being (as long as the kmem doesn't work), we can 
@@ -167,27 +439,75 @@ void irq_handler(void)
 		arm_enable_interrupts();
 		return;
 	}
+	/*
+	 * The top half is charged to the interrupted thread, as interrupt time.
+	 */
+	mode = kthread_mode_enter(KTHREAD_MODE_IRQ);
+#ifdef CONFIG_SMP
+	if (irq == KSMP_SGI_WAKEUP)
+	{
+		cortex_a9_gic_acknowledge_irq(irq, cpu);
+		kthread_mode_enter(mode);
+		arm_enable_interrupts();
+		return;
+	}
+#endif
+
+	irqStatsTop(irq);
+	PROBE_BEGIN(irq_handler);
+	LATENCY_BEGIN(top, KLATENCY_TOP, irq, irq_handler);
+	TRACE_BEGIN(KTRACE_IRQ_TOP, irq);
 
 	kIrqPendingEntry irqPendingEntry;
 	irqPendingEntry.irqId = irq;
+	irqPendingEntry.priority = IRQ_PRIORITY_DEFAULT;
+	irqPendingEntry.stamp = gtimer_read_low();
 	switch(irq)
 	{
 	case UART0_IRQ:
+	case UART1_IRQ:
+	case UART2_IRQ:
+	case UART3_IRQ:
 		/*
-		* You must do the read here first, from the UART0, before doing any print
-		* on the same serial line... Normally, this should not be necessary!
-		* The reason is obscure, it is because of an unexplained GCC behavior.
-		* For some unknown reason, GCC generates reads of the UART.DR register when writing to it...
-		* which therefore reads the pending character out of the FIFO and looses it.
-		* Also, the read may lower the IRQ line, if the read drops the number of pending
-		* characters in the receive FIFO below the RX interrupt threshold.
+		* The top half of the port empties the RX FIFO in the port RX ring,
+		* before doing any print on the same serial line, and refills the TX FIFO.
+		* The received characters are handed to the consumer of the port by the
+		* bottom half, requested once until it runs.
 		*/
-		uart_receive(stdin, &c);
-		irqPendingEntry.uart0.receivedChar	= c;
-		irqPendingEntry.uart0.handler		= handler_uart0_IRQ;
-		addPendingIrq(irqPendingEntry);
-		uart_ack_irqs(stdin);
-
+		kidle_arrival();
+		port = uart_port_of_irq(irq);
+		if (uart_port_irq(port))
+		{
+			irqPendingEntry.priority = IRQ_PRIORITY_UART;
+			irqPendingEntry.uart.port = port;
+			addPendingIrq(irqPendingEntry);
+		}
+		break;
+	case TIMER_PRIVATE_IRQ:
+		/*
+		* The tick of the timing wheel: the top half only acknowledges the timer,
+		* the timers are expired by the bottom half, requested once until it runs.
+		*/
+		kidle_arrival();
+		kthread_tick();
+		if (ktimer_irq())
+		{
+			irqPendingEntry.priority = IRQ_PRIORITY_TIMER;
+			addPendingIrq(irqPendingEntry);
+		}
+		break;
+	case TIMER_WATCHDOG_IRQ:
+		/*
+		* The latency watchdog: no bottom half, it looks at the interrupted PC.
+		*/
+		klatency_watchdog(frame);
+		timer_watchdog_ack();
+		break;
+	case KPROF_TIMER_IRQ:
+		/*
+		* The sampling profiler: no bottom half, it records the interrupted PC.
+		*/
+		kprof_sample(frame);
 		break;
 	default:
 		panic(666, "Unknown IRQ type\n\r");
@@ -200,6 +520,10 @@ void irq_handler(void)
 	kprintf("------------------------------\n\r");
 #endif
 	cortex_a9_gic_acknowledge_irq(irq, cpu);
+	TRACE_END(KTRACE_IRQ_TOP, irq);
+	LATENCY_END(top);
+	PROBE_END(irq_handler);
+	kthread_mode_enter(mode);
 
 	arm_enable_interrupts();
 }
@@ -232,7 +556,10 @@ void irq_handler(void)
 void irq_init() {
   vic_init();
   vic_enable_irq(PL190_UART0_INTR,0x0000BABE);
-  uart_enable_irqs(stdin,UART_IMSC_RXIM);
+  uart_enable_irqs(stdin->uart,UART_IMSC_RXIM);
+  sp804_init(SP804_0);
+  sp804_init(SP804_1);
+  vic_enable_irq(PL190_TIMER0_INTR,0x0000CAFE);
 }
 
 /**
@@ -241,23 +568,27 @@ void irq_init() {
  * (that is IRQs in the ARM parlance, usually FIQs are handled by a different handler.
  * See assembly setup in PL190.s.
  */
-void irq_handler()
+void irq_handler(struct irq_frame* frame)
 {
 	uint32_t isr = vic_isr();
-	if (isr==(uint32_t)0x0000BABE)
+	if (isr==(uint32_t)0x0000CAFE)
+	{
+		kprof_sample(frame);
+	}
+	else if (isr==(uint32_t)0x0000BABE)
 	{
 		char c = '.';
-		uart_receive(stdin, &c);
+		uart_receive(stdin->uart, &c);
 		if (c == 13)
 		{
-			uart_send(stdout, '\r');
-			uart_send(stdout, '\n');
+			uart_send(stdout->uart, '\r');
+			uart_send(stdout->uart, '\n');
 		}
 		else
 		{
-			uart_send(stdout, c);
+			uart_send(stdout->uart, c);
 		}
-		uart_ack_irqs(stdin);
+		uart_ack_irqs(stdin->uart);
 	}
 	vic_ack();
 }
@@ -266,10 +597,29 @@ void irq_handler()
 
 /**
  * This is called from kprintf, it is the hook to print a character out.
- * As you can see, we currently print out on the UART0.
+ * As you can see, we currently print out on the UART0. Once its port is
+ * opened, the characters go through the port TX ring, so that they do not
+ * interleave with the other writers of the port (see uart_port_write).
+ * The ring is only used where its writers can mask the interrupts: not
+ * from the USR mode (user.c prints with kprintf) nor from the abort and
+ * undefined modes, and on the boot processor only. The diagnostics must
+ * not be lost either, so the characters are also sent directly while the
+ * port is stopped by the peer (XOFF). The IRQ top halves run in SYS mode,
+ * with the interrupts disabled, so they use the ring.
  */
 void kputchar(int c, void *arg) {
-  uart_send(UART0, c);
+  struct uart_port* port = uart_get_port(0);
+  uint32_t mode = arm_mode();
+
+  if (port->opened && !port->tx_stopped &&
+      (mode == CPSR_SVC_MODE || mode == CPSR_SYS_MODE)
+#ifdef CONFIG_SMP
+      && ksmp_cpu() == 0
+#endif
+      )
+    uart_port_putc(port, c);
+  else
+    uart_send(UART0, c);
 }
 
 /**
@@ -306,16 +656,16 @@ void poll()
 	{
 		unsigned char c;
 		zzz();
-		if (0 == uart_receive(stdin, &c))
+		if (0 == uart_receive(stdin->uart, &c))
 			continue;
 		if (c == 13)
 		{
-			uart_send(stdout, '\r');
-			uart_send(stdout, '\n');
+			uart_send(stdout->uart, '\r');
+			uart_send(stdout->uart, '\n');
 		}
 		else
 		{
-			uart_send(stdout, c);
+			uart_send(stdout->uart, c);
 		}
 #ifdef CONFIG_TEST_MALLOC
 		if (nchunks>=NCHUNKS || c==13)
@@ -351,11 +701,35 @@ void poll()
 extern void umain(uint32_t userno);
 
 
+/**
+ * The system calls (swi #0, exit, is handled in gic.s). The value returned
+ * is handed back to the user code in r0.
+ */
+#define SYSCALL_SLEEP	1
+#define SYSCALL_TIMES	2	// r0: thread id (or KTHREAD_SELF), r1: uint64_t[KTHREAD_NB_MODES]
 
-void /* __attribute__ ((interrupt ("SWI"))) */
+uint32_t /* __attribute__ ((interrupt ("SWI"))) */
 swi_handler (uint32_t r0, uint32_t r1, uint32_t r2, uint32_t no)
 {
+	uint32_t ret = -1;
+#ifdef vexpress_a9
+	uint32_t mode = kthread_mode_enter(KTHREAD_MODE_KERNEL);
+
+	switch (no)
+	{
+	case SYSCALL_TIMES:
+		if (r1 != 0)
+			ret = kthread_times(r0, (uint64_t*)r1) ? 0 : -1;
+		break;
+	default:
+		kprintf("SWI no=%d, r0=0x%x r1=0x%x r2=0x%x  \n",no,r0,r1,r2);
+		break;
+	}
+	kthread_mode_enter(mode);
+#else
 	kprintf("SWI no=%d, r0=0x%x r1=0x%x r2=0x%x  \n",no,r0,r1,r2);
+#endif
+	return ret;
 }
 
 
@@ -368,23 +742,38 @@ void kmain()
 {
 	int i = 0;
 
-	stdin = UART0;
-	uart_init(stdin);
+	stdin = uart_get_port(0);
+	uart_init(stdin->uart);
 
 #ifdef LOCAL_ECHO
-	stdout = UART0;
+	stdout = stdin;
 #else
-	stdout = UART1;
-	uart_init(stdout);
+	stdout = uart_get_port(1);
+	uart_init(stdout->uart);
 #endif
 
 	space_valloc_init();
+#ifdef vexpress_a9
+	kclock_init();
+	kidle_init();
+	kpmu_init();
+	kvfp_init();
+#ifdef CONFIG_MMU
+	kmmu_init();
+#endif
+	kstack_init();
+	kthread_init();
+#endif
 
-	uart_send_string(stdout,	"\n\nHello world!\n\r");
-	uart_send_string(stdin,		"Please type here...\n\r");
+#if defined(CONFIG_BENCH_KPRINTF) && defined(vexpress_a9)
+	kbench_kprintf();
+#endif
+
+	uart_send_string(stdout->uart,	"\n\nHello world!\n\r");
+	uart_send_string(stdin->uart,	"Please type here...\n\r");
 
 #ifndef LOCAL_ECHO
-	uart_send_string(stdout,"\n\nCharacters will appear here...\n\r");
+	uart_send_string(stdout->uart,"\n\nCharacters will appear here...\n\r");
 #endif
 
 #ifdef CONFIG_POLLING
@@ -393,22 +782,100 @@ void kmain()
 	irq_init();
 	initIrqPendingList();
 	#ifdef vexpress_a9
+		/*
+		 * The user processes run on the main thread: their time is its user time.
+		 */
+		uint32_t mode = kthread_mode_enter(KTHREAD_MODE_USER);
 		umain(32);
 		umain(16);
+		kthread_mode_enter(mode);
 	#endif
 
 	arm_enable_interrupts();
-	uart_send_string(stdout, "IRQs enabled\n\r");
+	uart_send_string(stdout->uart, "IRQs enabled\n\r");
 
-	#ifdef CONFIG_TEST_TIMER
-		setTimmer(0xFFFFFFFF, 0);
-		uart_send_string(stdout, "Timer initially armed\n\r");
+	#ifdef vexpress_a9
+		ktimer_init();
+		kevent_init();
+		ksmp_init();
+	#ifndef CONFIG_CONSOLE
+		kcoro_start(&uartEcho.coro, uart_echo, KEVENT_PRIORITY_DEFAULT);
+	#endif
+	#endif
+	#if defined(CONFIG_SMP) && defined(vexpress_a9)
+		ksmp_start_secondaries();
+	#endif
+	#if defined(CONFIG_LATENCY_WATCHDOG) && defined(vexpress_a9)
+		klatency_init();
+	#endif
+	#ifdef CONFIG_KPROF
+		kprof_start(KPROF_DEFAULT_HZ);
+	#endif
+	#if defined(CONFIG_TEST_TIMER) && defined(vexpress_a9)
+		ktimer_setup(&testTimer, test_timer_expired, NULL);
+		ktimer_set_slack(&testTimer, NSEC_PER_SEC / 10);
+		ktimer_add_ns(&testTimer, NSEC_PER_SEC);
+		uart_send_string(stdout->uart, "Timer initially armed\n\r");
+	#endif
+	#if defined(CONFIG_TEST_COROS) && defined(vexpress_a9)
+		test_coros();
+	#endif
+	#if defined(CONFIG_TEST_THREADS) && defined(vexpress_a9)
+		kthread_create("spin1", test_thread, NULL);
+		kthread_create("spin2", test_thread, NULL);
+		kthread_create_edf("sampler", test_edf_thread, NULL, 20000000, 2000000, 0);
 	#endif
 	for (;;)
 	{
-		
-		handlAllPendingIrq();
+	#ifdef vexpress_a9
+		/*
+		* Run the bottoms within the budget of a pass, then one event:
+		* when the budget is exhausted or an event ran, come back here
+		* without sleeping, so that bottoms and events interleave.
+		*/
+		int exhausted = handlBudgetedPendingIrq();
+
+		if (kevent_dispatch() || exhausted)
+			continue;
+
+		/*
+		* Then the work events, of this processor or stolen from the others.
+		*/
+		if (kevent_work())
+			continue;
+
+		/*
+		* Nothing to do: let the other threads run, if any.
+		*/
+		if (kthread_yield())
+			continue;
+
+		/*
+		* Still nothing: spin for the adaptive window, in case an interrupt
+		* comes soon (see kidle.h), before going idle.
+		*/
+		if (kidle_spin())
+			continue;
+
+		/*
+		* Go idle with the interrupts disabled, so that no bottom half
+		* nor event can be posted after the check: an interrupt still wakes up
+		* the processor from WFI, and is taken once the interrupts are enabled.
+		*/
+		arm_disable_interrupts();
+		ksmp_idle_begin();
+		if (getNbPendingIrq() == 0 && !kevent_pending() && !kevent_work_pending())
+		{
+		#ifdef CONFIG_TICKLESS
+			ktimer_idle();
+		#endif
+			kidle_sleep();
+		}
+		ksmp_idle_end();
+		arm_enable_interrupts();
+	#else
 		_arm_sleep();
+	#endif
 /*
 uint32_t *ptr = kmalloc(sizeof(uint32_t));
 arm_mmio_write32(ptr, 0, 0x0000FFFF);
@@ -7,6 +7,7 @@
 
 #include "board.h"
 #include "kmem.h"
+#include "kprobe.h"
 
 #define VERBOSE_CLEANUP
 
@@ -167,6 +168,24 @@ void space_valloc_init() {
   kprintf("    -> %d empty pages \n",alloc->free.npages);
 }
 
+/**
+ * Fill in the given structure with the current state of the allocator.
+ */
+void space_valloc_stats(struct space_stats* stats) {
+  struct space_valloc* alloc = &_alloc;
+
+  stats->npages = alloc->npages;
+  stats->nzpages = alloc->nzpages;
+  stats->free_pages = alloc->free.npages;
+  stats->nholes = alloc->nholes;
+  stats->nchunks = alloc->nchunks;
+#ifdef CONFIG_SPACE_STATS
+  stats->allocated = alloc->allocated;
+#else
+  stats->allocated = 0;
+#endif
+}
+
 /**
  * Allocate a chunk of memory.
  * Note there is a maximum chunk size.
@@ -174,6 +193,7 @@ void space_valloc_init() {
 void* kmalloc(uint32_t size) {
 
   struct space_valloc* alloc = &_alloc;
+  PROBE_BEGIN(kmalloc);
 
   size = ALIGN32(size);
   if (size > MAX_HOLE_SIZE)
@@ -256,6 +276,7 @@ void* kmalloc(uint32_t size) {
 #endif
 
   void *addr = chunk_data(chunk);
+  PROBE_END(kmalloc);
   return addr;
 }
 
@@ -266,6 +287,7 @@ void kfree(void* addr) {
   struct _chunk* hole = chunk_of(addr);
   struct space_page* page = space_page_of(addr);
   struct space_valloc* alloc = page->allocator;
+  PROBE_BEGIN(kfree);
 
 #ifdef CONFIG_SPACE_STATS
   assert(alloc->allocated >= hole->size,
@@ -283,6 +305,7 @@ void kfree(void* addr) {
     alloc->nzpages++;
     assert(alloc->nzpages <= alloc->npages, "FIXME");
   }
+  PROBE_END(kfree);
 }
 
 /**
@@ -33,7 +33,21 @@
 #define MAX_HOLE_SIZE 3072
 #define MIN_HOLE_SIZE 32
 
+/*
+ * Snapshot of the state of the malloc/free subsystem.
+ * The allocated bytes are only counted with CONFIG_SPACE_STATS.
+ */
+struct space_stats {
+  uint32_t npages;      /* pages in use for chunks */
+  uint32_t nzpages;     /* pages in use, but with no allocated chunk */
+  uint32_t free_pages;  /* empty pages */
+  uint32_t nholes;      /* freed chunks, in the hole list */
+  uint32_t nchunks;     /* allocated chunks */
+  uint64_t allocated;   /* allocated bytes */
+};
+
 void space_valloc_init(void);
+void space_valloc_stats(struct space_stats* stats);
 void space_valloc_cleanup(void);
 void* kmalloc(uint32_t size);
 void kfree(void* addr);
@@ -0,0 +1,125 @@
+#include "kmmu.h"
+
+
+static uint32_t kmmuL1[KMMU_NB_SECTIONS] __attribute__((aligned(16384)));
+static uint32_t kmmuL2[KMMU_NB_L2_TABLES][KMMU_NB_PAGES] __attribute__((aligned(1024)));
+static uint32_t kmmuNbL2Tables;
+
+
+
+
+/**
+ * Clean the descriptor from the data cache, for the table walks,
+ * then invalidate the TLB entries of the address on all the processors.
+ */
+static void kmmu_sync(uint32_t *descriptor, uintptr_t addr)
+{
+	__asm__ __volatile__ ("mcr p15, 0, %0, c7, c10, 1" : : "r" (descriptor) : "memory");	// DCCMVAC
+	__asm__ __volatile__ ("dsb" : : : "memory");
+	__asm__ __volatile__ ("mcr p15, 0, %0, c8, c3, 1" : : "r" (addr & ~(KMMU_PAGE_SIZE - 1)) : "memory");	// TLBIMVAIS
+	__asm__ __volatile__ ("dsb\n\tisb" : : : "memory");
+}
+
+
+/**
+ * Build the flat mapping, then turn the MMU on, on the boot processor.
+ */
+void kmmu_init()
+{
+	uint32_t section, addr;
+
+	for (section=0; section<KMMU_NB_SECTIONS; section++)
+	{
+		addr = section << KMMU_SECTION_SHIFT;
+		if (addr >= VEXPRESS_DRAM_BASE && addr - VEXPRESS_DRAM_BASE < VEXPRESS_DRAM_SIZE)
+			kmmuL1[section] = addr | KMMU_L1_NORMAL;
+		else
+			kmmuL1[section] = addr | KMMU_L1_DEVICE;
+	}
+	kmmuNbL2Tables = 0;
+	kmmu_enable();
+}
+
+
+/**
+ * Turn the MMU on, on the current processor, with the table built by kmmu_init.
+ * The mapping is the identity: the execution goes on at the next instruction.
+ */
+void kmmu_enable()
+{
+	uint32_t sctlr;
+
+	__asm__ __volatile__ ("dsb" : : : "memory");
+	__asm__ __volatile__ ("mcr p15, 0, %0, c2, c0, 2" : : "r" (0));				// TTBCR: TTBR0 only
+	__asm__ __volatile__ ("mcr p15, 0, %0, c2, c0, 0" : : "r" ((uint32_t)kmmuL1));		// TTBR0, non cacheable walks
+	__asm__ __volatile__ ("mcr p15, 0, %0, c3, c0, 0" : : "r" (KMMU_DACR_CLIENT));		// DACR
+	__asm__ __volatile__ ("mcr p15, 0, %0, c8, c7, 0" : : "r" (0));				// TLBIALL
+	__asm__ __volatile__ ("mcr p15, 0, %0, c7, c5, 6" : : "r" (0));				// BPIALL
+	__asm__ __volatile__ ("dsb\n\tisb" : : : "memory");
+	__asm__ __volatile__ ("mrc p15, 0, %0, c1, c0, 0" : "=r" (sctlr));
+	sctlr |= 0x1;
+	__asm__ __volatile__ ("mcr p15, 0, %0, c1, c0, 0" : : "r" (sctlr) : "memory");
+	__asm__ __volatile__ ("isb" : : : "memory");
+}
+
+
+/**
+ * Second level descriptor of the page of the given address, splitting its section
+ * in small pages with the same attributes, if needed. NULL if the section is not
+ * normal memory, or if there is no second level table left.
+ */
+static uint32_t* kmmu_page_descriptor(uintptr_t addr)
+{
+	uint32_t	section = addr >> KMMU_SECTION_SHIFT;
+	uint32_t	*l2, i;
+
+	if ((kmmuL1[section] & 0x3) == KMMU_L1_COARSE)
+	{
+		l2 = (uint32_t*)(kmmuL1[section] & ~0x3FF);
+		return &l2[(addr >> KMMU_PAGE_SHIFT) & (KMMU_NB_PAGES - 1)];
+	}
+	if (kmmuL1[section] != ((section << KMMU_SECTION_SHIFT) | KMMU_L1_NORMAL) || kmmuNbL2Tables == KMMU_NB_L2_TABLES)
+		return NULL;
+
+	l2 = kmmuL2[kmmuNbL2Tables++];
+	for (i=0; i<KMMU_NB_PAGES; i++)
+	{
+		l2[i] = (section << KMMU_SECTION_SHIFT) | (i << KMMU_PAGE_SHIFT) | KMMU_L2_NORMAL;
+		__asm__ __volatile__ ("mcr p15, 0, %0, c7, c10, 1" : : "r" (&l2[i]) : "memory");
+	}
+	kmmuL1[section] = (uint32_t)l2 | KMMU_L1_COARSE;
+	kmmu_sync(&kmmuL1[section], section << KMMU_SECTION_SHIFT);
+	__asm__ __volatile__ ("mcr p15, 0, %0, c8, c3, 0" : : "r" (0) : "memory");		// TLBIALLIS, the whole section
+	__asm__ __volatile__ ("dsb\n\tisb" : : : "memory");
+	return &l2[(addr >> KMMU_PAGE_SHIFT) & (KMMU_NB_PAGES - 1)];
+}
+
+
+/**
+ * Unmap the 4KB page of the given address. Returns false if it cannot be.
+ */
+int kmmu_unmap_page(void *addr)
+{
+	uint32_t *descriptor = kmmu_page_descriptor((uintptr_t)addr);
+
+	if (descriptor == NULL)
+		return 0;
+	*descriptor = 0;
+	kmmu_sync(descriptor, (uintptr_t)addr);
+	return 1;
+}
+
+
+/**
+ * Map back the 4KB page of the given address, as normal memory.
+ */
+int kmmu_map_page(void *addr)
+{
+	uint32_t *descriptor = kmmu_page_descriptor((uintptr_t)addr);
+
+	if (descriptor == NULL)
+		return 0;
+	*descriptor = ((uintptr_t)addr & ~(KMMU_PAGE_SIZE - 1)) | KMMU_L2_NORMAL;
+	kmmu_sync(descriptor, (uintptr_t)addr);
+	return 1;
+}
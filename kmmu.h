@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) SID LAKHDAR Riyane.
+ *
+ * This code is a patch to the code implemented by Pr Olivier 
+ * Gruber during the Advanced Operating System cours.
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Classpath; see the file COPYING.  If not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA.
+ *
+ */
+
+
+#ifndef KMMU_H
+#define KMMU_H
+
+#include "board.h"
+
+
+/**
+ * Flat (identity) mapping of the address space by the MMU (CONFIG_MMU).
+ *
+ * The first level translation table maps the 4GB in 1MB sections: the DRAM as
+ * normal memory, cacheable (write-back, write-allocate) and shareable between the
+ * processors, everything else as shareable device memory, never executed.
+ * A section is split into 4KB small pages, through a second level table, when one
+ * of its pages is unmapped: an access to an unmapped page is a translation fault,
+ * a data abort (see kstack_fault).
+ *
+ * The table walks are not cacheable: the updated descriptors are cleaned from the
+ * data cache to the point of coherency, before the TLB is invalidated.
+ * See the ARM Architecture Reference Manual, ARMv7-A, section B3.5 (short descriptors).
+ */
+#define KMMU_SECTION_SHIFT	20
+#define KMMU_SECTION_SIZE	(1 << KMMU_SECTION_SHIFT)
+#define KMMU_PAGE_SHIFT		12
+#define KMMU_PAGE_SIZE		(1 << KMMU_PAGE_SHIFT)
+#define KMMU_NB_SECTIONS	4096
+#define KMMU_NB_PAGES		256		// Small pages per section
+#define KMMU_NB_L2_TABLES	4		// Sections that can be split
+
+#define VEXPRESS_DRAM_BASE	0x60000000
+#define VEXPRESS_DRAM_SIZE	0x40000000
+
+/**
+ * First level descriptors
+ */
+#define KMMU_L1_COARSE		0x00001		// Second level table
+#define KMMU_L1_SECTION		0x00002
+#define KMMU_L1_B		(1 << 2)
+#define KMMU_L1_C		(1 << 3)
+#define KMMU_L1_XN		(1 << 4)
+#define KMMU_L1_AP_RW		(3 << 10)	// Read/write, at any privilege
+#define KMMU_L1_TEX(n)		((n) << 12)
+#define KMMU_L1_S		(1 << 16)
+
+#define KMMU_L1_NORMAL		(KMMU_L1_SECTION | KMMU_L1_AP_RW | KMMU_L1_TEX(1) | KMMU_L1_C | KMMU_L1_B | KMMU_L1_S)
+#define KMMU_L1_DEVICE		(KMMU_L1_SECTION | KMMU_L1_AP_RW | KMMU_L1_B | KMMU_L1_XN)
+
+/**
+ * Second level descriptors
+ */
+#define KMMU_L2_SMALL		0x002
+#define KMMU_L2_B		(1 << 2)
+#define KMMU_L2_C		(1 << 3)
+#define KMMU_L2_AP_RW		(3 << 4)
+#define KMMU_L2_TEX(n)		((n) << 6)
+#define KMMU_L2_S		(1 << 10)
+
+#define KMMU_L2_NORMAL		(KMMU_L2_SMALL | KMMU_L2_AP_RW | KMMU_L2_TEX(1) | KMMU_L2_C | KMMU_L2_B | KMMU_L2_S)
+
+#define KMMU_DACR_CLIENT	0x1		// Domain 0, accesses checked against the descriptors
+
+
+
+
+void	kmmu_init		();
+void	kmmu_enable		();
+int	kmmu_unmap_page		(void *addr);
+int	kmmu_map_page		(void *addr);
+
+
+
+#endif
@@ -0,0 +1,65 @@
+#include "kpmu.h"
+
+
+/**
+ * Events counted by the event counters, in this order.
+ */
+static const uint32_t	kpmuEvents[KPMU_NB_EVENTS] =
+{
+	KPMU_EVENT_L1D_REFILL,
+	KPMU_EVENT_L1I_REFILL,
+	KPMU_EVENT_DTLB_REFILL,
+	KPMU_EVENT_BRANCH_MISPREDICT,
+};
+
+static const char	*kpmuEventNames[KPMU_NB_EVENTS] =
+{
+	"l1d_refill",
+	"l1i_refill",
+	"dtlb_refill",
+	"br_mispredict",
+};
+
+
+
+
+/**
+ * Reset and start the cycle counter (no divider) and the event counters,
+ * with their overflow interrupts disabled.
+ */
+void kpmu_init()
+{
+	uint32_t pmcr, enable, counter;
+
+	// PMINTENCLR: no overflow interrupt
+	__asm__ __volatile__ ("mcr p15, 0, %0, c9, c14, 2" : : "r" (0xFFFFFFFF));
+	// PMCNTENCLR: stop all the counters while they are configured
+	__asm__ __volatile__ ("mcr p15, 0, %0, c9, c12, 2" : : "r" (0xFFFFFFFF));
+
+	enable = (1 << KPMU_BIT_CNTEN_CYCLE);
+	for (counter=0; counter<KPMU_NB_EVENTS; counter++)
+	{
+		// PMSELR then PMXEVTYPER
+		__asm__ __volatile__ ("mcr p15, 0, %0, c9, c12, 5" : : "r" (counter));
+		__asm__ __volatile__ ("isb");
+		__asm__ __volatile__ ("mcr p15, 0, %0, c9, c13, 1" : : "r" (kpmuEvents[counter]));
+		enable |= (1 << counter);
+	}
+
+	// PMOVSR: clear the overflow flags
+	__asm__ __volatile__ ("mcr p15, 0, %0, c9, c12, 3" : : "r" (0xFFFFFFFF));
+
+	pmcr = (1 << KPMU_BIT_PMCR_ENABLE) | (1 << KPMU_BIT_PMCR_EVENT_RESET) | (1 << KPMU_BIT_PMCR_CYCLE_RESET);
+	__asm__ __volatile__ ("mcr p15, 0, %0, c9, c12, 0" : : "r" (pmcr));
+	// PMCNTENSET
+	__asm__ __volatile__ ("mcr p15, 0, %0, c9, c12, 1" : : "r" (enable));
+	__asm__ __volatile__ ("isb");
+}
+
+
+const char *kpmu_event_name(uint32_t counter)
+{
+	if (counter >= KPMU_NB_EVENTS)
+		return "?";
+	return kpmuEventNames[counter];
+}
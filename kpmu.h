@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) SID LAKHDAR Riyane.
+ *
+ * This code is a patch to the code implemented by Pr Olivier 
+ * Gruber during the Advanced Operating System cours.
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Classpath; see the file COPYING.  If not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA.
+ *
+ */
+
+
+#ifndef KPMU_H
+#define KPMU_H
+
+#include "board.h"
+
+
+/**
+ * Cortex-A9 Performance Monitoring Unit (ARMv7 PMUv1), accessed through CP15 c9.
+ * It has a 32-bit cycle counter (PMCCNTR), counting the processor cycles,
+ * and 6 event counters, each one counting the event selected in PMXEVTYPER.
+ *
+ * The PMU is started at boot with KPMU_NB_EVENTS event counters, counting the
+ * events of kpmuEvents (see kpmu.c): L1 cache refills, TLB refills and branch
+ * mispredictions.
+ */
+#define KPMU_NB_COUNTERS		6
+#define KPMU_NB_EVENTS			4
+
+/**
+ * PMCR: Performance Monitor Control Register
+ */
+#define KPMU_BIT_PMCR_ENABLE		0
+#define KPMU_BIT_PMCR_EVENT_RESET	1
+#define KPMU_BIT_PMCR_CYCLE_RESET	2
+#define KPMU_BIT_PMCR_CYCLE_DIV64	3
+
+#define KPMU_BIT_CNTEN_CYCLE		31
+
+/**
+ * ARMv7 common events, and Cortex-A9 specific ones
+ */
+#define KPMU_EVENT_L1I_REFILL		0x01
+#define KPMU_EVENT_ITLB_REFILL		0x02
+#define KPMU_EVENT_L1D_REFILL		0x03
+#define KPMU_EVENT_L1D_ACCESS		0x04
+#define KPMU_EVENT_DTLB_REFILL		0x05
+#define KPMU_EVENT_EXCEPTION		0x09
+#define KPMU_EVENT_BRANCH_MISPREDICT	0x10
+#define KPMU_EVENT_CYCLES		0x11
+#define KPMU_EVENT_BRANCH_PREDICTED	0x12
+#define KPMU_EVENT_A9_INSTRUCTIONS	0x68	// Instructions going through the register renaming
+
+
+
+
+void		kpmu_init		();
+const char	*kpmu_event_name	(uint32_t counter);
+
+
+/**
+ * Processor cycles, since the PMU was started.
+ */
+ALWAYS_INLINE
+uint32_t kpmu_cycles()
+{
+	uint32_t value;
+	__asm__ __volatile__ ("mrc p15, 0, %0, c9, c13, 0" : "=r" (value));
+	return value;
+}
+
+
+/**
+ * Value of the given event counter.
+ */
+ALWAYS_INLINE
+uint32_t kpmu_read_counter(uint32_t counter)
+{
+	uint32_t value;
+	__asm__ __volatile__ ("mcr p15, 0, %0, c9, c12, 5" : : "r" (counter));
+	__asm__ __volatile__ ("isb");
+	__asm__ __volatile__ ("mrc p15, 0, %0, c9, c13, 2" : "=r" (value));
+	return value;
+}
+
+
+
+#endif
@@ -38,13 +38,13 @@
 // typedef long ssize_t;
 // #define NULL ((void*)0)
 
-#ifdef __64BIT__
+/*
+ * The widest integers are 64-bit, also on the 32-bit ARM, so that the
+ * 64-bit arguments (%ll, %q, %j) are not truncated. The 64-bit divisions
+ * are done by __aeabi_uldivmod (see libaeabi).
+ */
 typedef unsigned long long uintmax_t;
 typedef long long intmax_t;
-#else
-typedef unsigned int uintmax_t;
-typedef int intmax_t;
-#endif
 typedef unsigned char u_char;
 typedef unsigned int u_int;
 typedef unsigned long u_long;
@@ -86,13 +86,24 @@ strlen(const char *s) {
 static char *
 ksprintn(char *nbuf, uintmax_t num, int base, int *lenp, int upper) {
   char *p, c;
+  u_int low;
   
   p = nbuf;
   *p = '\0';
-  do {
+  /*
+   * The 64-bit divisions only while the number does not fit in 32 bits,
+   * most numbers never need them.
+   */
+  while (num >> 32) {
     c = hex2ascii(num % base);
     *++p = upper ? toupper(c) : c;
-  } while (0!=(num = num /base));
+    num = num / base;
+  }
+  low = (u_int)num;
+  do {
+    c = hex2ascii(low % base);
+    *++p = upper ? toupper(c) : c;
+  } while (0!=(low = low /base));
   if (lenp)
     *lenp = p - nbuf;
   return (p);
@@ -439,6 +450,80 @@ number:
 
 extern void kputchar(int c, void *arg);
 
+/*
+ * State of a bounded in-memory formatting, see kvsnprintf().
+ * The field remain counts the bytes still available in the buffer,
+ * including the space for the terminating NUL byte.
+ */
+struct snprintf_arg {
+  char *str;
+  size_t remain;
+};
+
+static void
+snprintf_func(int ch, void *arg) {
+  struct snprintf_arg *const info = arg;
+
+  if (info->remain >= 2) {
+    *info->str++ = ch;
+    info->remain--;
+  }
+}
+
+/*
+ * Scaled down version of vsnprintf(3).
+ *
+ * Formats into the buffer `str', writing at most `size' bytes,
+ * including the terminating NUL byte which is always written when
+ * size is not zero. The returned value is the length the formatted
+ * string would have had without the bound, so a returned value
+ * greater or equal to size means the output was truncated.
+ *
+ * The literal prefix of the format, often the whole format, is copied
+ * directly, without going through kvprintf() one character at a time.
+ */
+int
+kvsnprintf(char *str, size_t size, const char *fmt, va_list ap) {
+  struct snprintf_arg info;
+  const char *p;
+  size_t n;
+
+  if (fmt == NULL)
+    fmt = "(fmt null)\n";
+
+  for (p = fmt; *p != '%' && *p != '\0'; p++)
+    continue;
+  n = p - fmt;
+
+  info.str = str;
+  info.remain = size;
+  if (size > 0) {
+    size_t len = (n < size - 1) ? n : size - 1;
+    const char *q = fmt;
+    while (len--)
+      *info.str++ = *q++;
+    info.remain -= (info.str - str);
+  }
+
+  if (*p != '\0')
+    n += kvprintf(p, snprintf_func, &info, 10, ap);
+
+  if (info.remain >= 1)
+    *info.str = '\0';
+  return (n);
+}
+
+int
+ksnprintf(char *str, size_t size, const char *fmt, ...) {
+  va_list ap;
+  int retval;
+
+  va_start(ap, fmt);
+  retval = kvsnprintf(str, size, fmt, ap);
+  va_end(ap);
+  return (retval);
+}
+
 void
 kprintf(const char *fmt, ...) {
   /* http://www.pagetable.com/?p=298 */
@@ -0,0 +1,63 @@
+#include "kprobe.h"
+#include "gic.h"
+
+
+#if defined(CONFIG_PROBES) && defined(vexpress_a9)
+
+static struct kprobe	*kprobes;
+
+
+
+
+/**
+ * Accumulate the run of the probe (interrupts disabled, since the same probe
+ * may be run by an interrupt handler) and register the probe on its first run.
+ */
+void kprobe_end(struct kprobe *probe, struct kprobe_start *start)
+{
+	uint32_t	cycles = kpmu_cycles() - start->cycles;
+	uint32_t	i;
+	int		enabled = arm_disable_interrupts();
+
+	for (i=0; i<KPMU_NB_EVENTS; i++)
+		probe->events[i] += kpmu_read_counter(i) - start->events[i];
+	probe->cycles += cycles;
+	if (cycles > probe->maxCycles)
+		probe->maxCycles = cycles;
+	probe->count++;
+	if (!probe->registered)
+	{
+		probe->registered	= 1;
+		probe->next		= kprobes;
+		kprobes			= probe;
+	}
+	if (enabled)
+		arm_enable_interrupts();
+}
+
+
+struct kprobe *kprobe_list()
+{
+	return kprobes;
+}
+
+
+void kprobe_reset()
+{
+	struct kprobe	*probe;
+	uint32_t	i;
+	int		enabled = arm_disable_interrupts();
+
+	for (probe=kprobes; probe; probe=probe->next)
+	{
+		probe->count		= 0;
+		probe->cycles		= 0;
+		probe->maxCycles	= 0;
+		for (i=0; i<KPMU_NB_EVENTS; i++)
+			probe->events[i] = 0;
+	}
+	if (enabled)
+		arm_enable_interrupts();
+}
+
+#endif
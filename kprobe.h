@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) SID LAKHDAR Riyane.
+ *
+ * This code is a patch to the code implemented by Pr Olivier 
+ * Gruber during the Advanced Operating System cours.
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Classpath; see the file COPYING.  If not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA.
+ *
+ */
+
+
+#ifndef KPROBE_H
+#define KPROBE_H
+
+#include "board.h"
+
+
+/**
+ * Probes: timing of hot paths with the PMU counters.
+ *
+ *	PROBE_BEGIN(kmalloc);
+ *	...
+ *	PROBE_END(kmalloc);
+ *
+ * Each named probe accumulates, over all its runs, the processor cycles and the
+ * PMU events (see kpmu.h) spent between PROBE_BEGIN and PROBE_END, which must be
+ * in the same block. A probe is registered (listed by the console) on its first run.
+ * Without CONFIG_PROBES, the macros expand to nothing.
+ */
+#if defined(CONFIG_PROBES) && defined(vexpress_a9)
+
+#include "kpmu.h"
+
+struct kprobe
+{
+	const char	*name;
+	uint32_t	count;
+	uint64_t	cycles;
+	uint32_t	maxCycles;
+	uint64_t	events[KPMU_NB_EVENTS];
+	struct kprobe	*next;
+	uint8_t		registered;
+};
+
+struct kprobe_start
+{
+	uint32_t	cycles;
+	uint32_t	events[KPMU_NB_EVENTS];
+};
+
+
+ALWAYS_INLINE
+void kprobe_begin(struct kprobe_start *start)
+{
+	uint32_t i;
+
+	for (i=0; i<KPMU_NB_EVENTS; i++)
+		start->events[i] = kpmu_read_counter(i);
+	start->cycles = kpmu_cycles();
+}
+
+void		kprobe_end	(struct kprobe *probe, struct kprobe_start *start);
+struct kprobe	*kprobe_list	();
+void		kprobe_reset	();
+
+
+#define PROBE_BEGIN(probeName)							\
+	static struct kprobe __probe_##probeName = { .name = #probeName };	\
+	struct kprobe_start __probe_start_##probeName;				\
+	kprobe_begin(&__probe_start_##probeName)
+
+#define PROBE_END(probeName)							\
+	kprobe_end(&__probe_##probeName, &__probe_start_##probeName)
+
+#else
+
+#define PROBE_BEGIN(probeName)
+#define PROBE_END(probeName)
+
+#endif
+
+
+
+#endif
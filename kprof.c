@@ -0,0 +1,123 @@
+#include "kprof.h"
+#include "pl011.h"
+
+
+static struct kprof_ring	kprofRings[KPROF_NB_CPUS];
+static uint32_t			kprofHz;
+
+
+
+
+/**
+ * Start sampling at the given frequency, on the current processor.
+ */
+void kprof_start(uint32_t hz)
+{
+	if (hz == 0)
+		hz = KPROF_DEFAULT_HZ;
+	kprofHz = hz;
+	sp804_arm_periodic(KPROF_TIMER, SP804_CLK_HZ / hz);
+}
+
+
+void kprof_stop()
+{
+	sp804_disarm(KPROF_TIMER);
+	kprofHz = 0;
+}
+
+
+/**
+ * Sampling frequency, 0 if the profiler is stopped.
+ */
+uint32_t kprof_hz()
+{
+	return kprofHz;
+}
+
+
+/**
+ * Top half of the profiler timer interrupt: record the interrupted PC and LR.
+ * The ARMv5 processor of the VersatilePB has no multiprocessor identification.
+ */
+void kprof_sample(struct irq_frame *frame)
+{
+#ifdef vexpress_a9
+	struct kprof_ring	*ring = &kprofRings[armv7_coreid()];
+#else
+	struct kprof_ring	*ring = &kprofRings[0];
+#endif
+	struct kprof_sample	*sample;
+
+	if (!sp804_ack(KPROF_TIMER))
+		return;
+	if (ring->head - ring->tail >= KPROF_NB_SAMPLES)
+	{
+		ring->nbLost++;
+		return;
+	}
+	sample		= &ring->samples[ring->head & KPROF_SAMPLES_MASK];
+	sample->pc	= frame->pc;
+	sample->lr	= frame->lr;
+	ring->head++;
+}
+
+
+uint32_t kprof_nb_samples(uint32_t cpu)
+{
+	return kprofRings[cpu].head - kprofRings[cpu].tail;
+}
+
+
+/**
+ * Write and remove all the recorded samples, per processor.
+ * The sampling may go on meanwhile: the samples recorded during the dump
+ * are left for the next one.
+ */
+void kprof_dump(kprof_write_t write, void *arg)
+{
+	char			line[64];
+	struct kprof_ring	*ring;
+	struct kprof_sample	*sample;
+	uint32_t		cpu, head, length;
+
+	for (cpu=0; cpu<KPROF_NB_CPUS; cpu++)
+	{
+		ring = &kprofRings[cpu];
+		head = ring->head;
+		if (head == ring->tail && ring->nbLost == 0)
+			continue;
+		length = ksnprintf(line, sizeof(line), "# kprof cpu=%d hz=%d samples=%d lost=%d\n",
+			cpu, kprofHz, head - ring->tail, ring->nbLost);
+		write(line, length, arg);
+		ring->nbLost = 0;
+		while (ring->tail != head)
+		{
+			sample = &ring->samples[ring->tail & KPROF_SAMPLES_MASK];
+			length = ksnprintf(line, sizeof(line), "%08x %08x\n", sample->pc, sample->lr);
+			write(line, length, arg);
+			ring->tail++;
+		}
+	}
+	write("# kprof end\n", 12, arg);
+}
+
+
+static void kprof_write_uart(const char *line, uint32_t length, void *arg)
+{
+	struct pl011_uart *uart = (struct pl011_uart*)arg;
+
+	while (length--)
+		uart_send(uart, *line++);
+}
+
+
+/**
+ * Dump the samples on the spare serial line, with polled writes,
+ * so that the dump does not depend on the interrupts.
+ */
+void kprof_stream()
+{
+	uart_init(KPROF_STREAM_UART);
+	kprof_dump(kprof_write_uart, KPROF_STREAM_UART);
+}
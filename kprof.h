@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) SID LAKHDAR Riyane.
+ *
+ * This code is a patch to the code implemented by Pr Olivier 
+ * Gruber during the Advanced Operating System cours.
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Classpath; see the file COPYING.  If not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA.
+ *
+ */
+
+
+#ifndef KPROF_H
+#define KPROF_H
+
+#include "board.h"
+#include "sp804.h"
+#ifdef vexpress_a9
+#include "gic.h"
+#else
+#include "pl190.h"
+#endif
+
+
+/**
+ * Statistical profiler.
+ * A periodic channel of the first SP804 dual timer interrupts the processor its
+ * interrupt is routed to, on both boards, leaving the Cortex-A9 watchdog to the
+ * latency watchdog: the top half records the interrupted PC and LR (from the IRQ frame)
+ * in the sample ring of the processor. No bottom half is involved.
+ * The code running with the interrupts disabled (the top halves) is not sampled,
+ * its time is accounted to the code that re-enables the interrupts.
+ *
+ * The samples are dumped as text lines, on the console or on a spare serial line
+ * (stream), and symbolized on the host by tools/kprof.py:
+ *	# kprof cpu=<cpu> hz=<hz> samples=<n> lost=<n>
+ *	<pc> <lr>
+ *	...
+ *	# kprof end
+ */
+#define KPROF_NB_CPUS		4
+#define KPROF_NB_SAMPLES	2048	// per CPU, must be a power of two
+#define KPROF_SAMPLES_MASK	(KPROF_NB_SAMPLES - 1)
+#define KPROF_DEFAULT_HZ	10000
+#define KPROF_STREAM_UART	UART2
+#define KPROF_TIMER		SP804_CHANNEL(SP804_0, 0)
+#define KPROF_TIMER_IRQ		SP804_0_IRQ
+
+struct kprof_sample
+{
+	uint32_t	pc;
+	uint32_t	lr;
+};
+
+struct kprof_ring
+{
+	uint32_t		head;		// Only written by the sampling top half
+	uint32_t		tail;		// Only written by the dump
+	uint32_t		nbLost;		// Samples lost while the ring was full
+	struct kprof_sample	samples[KPROF_NB_SAMPLES];
+};
+
+/**
+ * Output of a dump: a line of text (with its end of line).
+ */
+typedef void (*kprof_write_t)(const char *line, uint32_t length, void *arg);
+
+
+
+
+void		kprof_start		(uint32_t hz);
+void		kprof_stop		();
+uint32_t	kprof_hz		();
+void		kprof_sample		(struct irq_frame *frame);
+uint32_t	kprof_nb_samples	(uint32_t cpu);
+void		kprof_dump		(kprof_write_t write, void *arg);
+void		kprof_stream		();
+
+
+
+#endif
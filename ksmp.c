@@ -0,0 +1,192 @@
+#include "ksmp.h"
+#include "gic.h"
+#include "gid.h"
+#include "kevent.h"
+#include "kvfp.h"
+#ifdef CONFIG_MMU
+#include "kmmu.h"
+#endif
+
+
+/**
+ * Stacks of the processors, KSMP_STACK_SIZE each, set by _secondary_entry (gic.s):
+ * the IRQ stack in the second KB, the ABT stack in the third KB, the stack shared
+ * by the other exception modes in the first KB, and the SYS (C) stack above.
+ * The one of the boot processor is unused, it has its stacks in the ldscript.
+ */
+uint8_t ksmpStacks[KSMP_NB_CPUS][KSMP_STACK_SIZE] __attribute__((aligned(8)));
+
+static struct ksmp_stats ksmpStats;
+
+extern void _secondary_entry(void);
+extern void _arm_sleep(void);
+
+#define KSMP_BOOT_TIMEOUT	10000000	// Polls of the online mask
+#define ARM_SCU_CONFIG		0x04
+#define ARM_ACTLR_SMP		(1 << 6)
+
+
+
+
+/**
+ * The boot processor is the only one online until ksmp_start_secondaries.
+ */
+void ksmp_init()
+{
+	ksmpStats.nbCpus	= 1;
+	ksmpStats.online	= 1 << ksmp_cpu();
+	ksmpStats.idle		= 0;
+}
+
+
+/**
+ * Enable the coherency of the L1 data cache of this processor with the others.
+ */
+static void ksmp_join_coherency()
+{
+	uint32_t actlr;
+
+	__asm__ __volatile__ ("mrc p15, 0, %0, c1, c0, 1" : "=r" (actlr));
+	actlr |= ARM_ACTLR_SMP;
+	__asm__ __volatile__ ("mcr p15, 0, %0, c1, c0, 1" : : "r" (actlr));
+	__asm__ __volatile__ ("isb" : : : "memory");
+}
+
+
+/**
+ * Enable the Snoop Control Unit, publish the entry point of the secondaries
+ * and wake them up, then wait until they are online (or a timeout, when QEMU
+ * emulates fewer processors than the SCU reports).
+ */
+void ksmp_start_secondaries()
+{
+	uintptr_t	scu = cortex_a9_peripheral_base();
+	uint32_t	nbCpus, i;
+
+	nbCpus = (arm_mmio_read32(scu, ARM_SCU_CONFIG) & 0x3) + 1;
+	if (nbCpus > KSMP_NB_CPUS)
+		nbCpus = KSMP_NB_CPUS;
+	ksmpStats.nbCpus = nbCpus;
+	if (nbCpus == 1)
+		return;
+
+	arm_mmio_write32(scu, ARM_SCU_CONTROL, arm_mmio_read32(scu, ARM_SCU_CONTROL) | ARM_SCU_CONTROL_ENABLE);
+	ksmp_join_coherency();
+
+	arm_mmio_write32(VEXPRESS_SYS_BASE, VEXPRESS_SYS_FLAGSCLR, 0xFFFFFFFF);
+	arm_mmio_write32(VEXPRESS_SYS_BASE, VEXPRESS_SYS_FLAGSSET, (uint32_t)_secondary_entry);
+	__asm__ __volatile__ ("dsb\n\tsev" : : : "memory");
+	cortex_a9_gid_soft_irq(((1 << nbCpus) - 1) & ~ksmpStats.online, KSMP_SGI_WAKEUP);
+
+	for (i=0; i<KSMP_BOOT_TIMEOUT; i++)
+	{
+		ksmp_dmb();
+		if (ksmpStats.online == (uint32_t)((1 << nbCpus) - 1))
+			break;
+	}
+}
+
+
+/**
+ * Entry point in C of a secondary processor, from _secondary_entry (gic.s),
+ * on its own stacks: enable its CPU interface and the wake up SGI, and
+ * run work events, forever.
+ */
+void ksmp_secondary_main(uint32_t cpu)
+{
+	ksmp_join_coherency();
+#ifdef CONFIG_MMU
+	kmmu_enable();
+#endif
+	kvfp_init_secondary();
+	cortex_a9_gic_init();
+	cortex_a9_gid_enable_irq(KSMP_SGI_WAKEUP);
+	ksmp_fetch_or(&ksmpStats.online, 1 << cpu);
+	arm_enable_interrupts();
+
+	for (;;)
+	{
+		if (!kevent_work())
+			ksmp_idle();
+	}
+}
+
+
+/**
+ * Mark the current processor idle, to be called with the interrupts disabled,
+ * before the last check for work: a processor posting work after the check
+ * sees the mark and sends the wake up SGI, which ends the WFI.
+ */
+void ksmp_idle_begin()
+{
+	ksmp_fetch_or(&ksmpStats.idle, 1 << ksmp_cpu());
+	ksmp_dmb();
+}
+
+
+void ksmp_idle_end()
+{
+	ksmp_fetch_and_not(&ksmpStats.idle, 1 << ksmp_cpu());
+}
+
+
+/**
+ * Idle loop of a secondary processor: wait for an interrupt if there is
+ * no work to execute or to steal.
+ */
+void ksmp_idle()
+{
+	arm_disable_interrupts();
+	ksmp_idle_begin();
+	if (!kevent_work_pending())
+	{
+		ksmpStats.nbSleeps[ksmp_cpu()]++;
+		_arm_sleep();
+	}
+	ksmp_idle_end();
+	arm_enable_interrupts();
+}
+
+
+/**
+ * Work was posted: wake up one idle processor, if any. Its idle mark is
+ * cleared here, so that the following posts wake up the other ones.
+ */
+void ksmp_wakeup()
+{
+	uint32_t self = 1 << ksmp_cpu();
+	uint32_t current, idle, target;
+
+	do
+	{
+		current	= ksmpStats.idle;
+		idle	= current & ksmpStats.online & ~self;
+		if (idle == 0)
+			return;
+		target	= idle & -idle;
+	} while (!ksmp_cas(&ksmpStats.idle, current, current & ~target));
+	cortex_a9_gid_soft_irq(target, KSMP_SGI_WAKEUP);
+}
+
+
+/**
+ * Interrupt on a secondary processor: only the wake up SGI is expected,
+ * waking up the processor is all it does.
+ */
+void ksmp_irq()
+{
+	irq_id_t irq;
+	cpu_id_t cpu;
+
+	cortex_a9_gic_get_current_irq(&irq, &cpu);
+	if (ARM_GIC_IAR_SPURIOUS(irq))
+		return;
+	ksmpStats.nbWakeups[ksmp_cpu()]++;
+	cortex_a9_gic_acknowledge_irq(irq, cpu);
+}
+
+
+void ksmp_get_stats(struct ksmp_stats *stats)
+{
+	*stats = ksmpStats;
+}
@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) SID LAKHDAR Riyane.
+ *
+ * This code is a patch to the code implemented by Pr Olivier 
+ * Gruber during the Advanced Operating System cours.
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Classpath; see the file COPYING.  If not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA.
+ *
+ */
+
+
+#ifndef KSMP_H
+#define KSMP_H
+
+#include "board.h"
+
+
+/**
+ * Secondary processors of the Cortex-A9 MPCore (CONFIG_SMP).
+ *
+ * The boot processor writes the entry point of the secondaries (_secondary_entry,
+ * gic.s) in the flags register of the VExpress system registers, and wakes them up
+ * with a software generated interrupt (SGI): the QEMU boot loader of the secondaries
+ * waits for an interrupt, then jumps to the flags register, if not zero.
+ * Each secondary gets its own stacks (ksmpStacks), its CPU interface, and runs
+ * ksmp_secondary_main: it executes the work events (see kevent_spawn), its own and
+ * the ones stolen from the other processors, and waits for an interrupt when there
+ * is none. A processor posting work wakes up an idle one with the KSMP_SGI_WAKEUP SGI.
+ *
+ * The secondaries only take SGIs: the device interrupts, the tops, bottoms, timers
+ * and threads stay on the boot processor.
+ *
+ * Synchronization between processors relies on the exclusive accesses (LDREX/STREX)
+ * and on the memory barriers (DMB).
+ */
+#define KSMP_NB_CPUS		4
+#define KSMP_SGI_WAKEUP		1
+#define KSMP_STACK_SHIFT	13		// 8KB of stacks per processor, see gic.s
+#define KSMP_STACK_SIZE		(1 << KSMP_STACK_SHIFT)
+
+/**
+ * VExpress system registers: flags, holding the entry point of the secondaries
+ */
+#define VEXPRESS_SYS_BASE	((void*)0x10000000)
+#define VEXPRESS_SYS_FLAGSSET	0x30
+#define VEXPRESS_SYS_FLAGSCLR	0x34
+
+/**
+ * Snoop Control Unit, at the base of the private memory region (see board.h)
+ */
+#define ARM_SCU_CONTROL		0x00
+#define ARM_SCU_CONTROL_ENABLE	0x01
+
+
+
+
+struct ksmp_stats
+{
+	uint32_t		nbCpus;				// Processors of the MPCore
+	volatile uint32_t	online;				// Mask of the running processors
+	volatile uint32_t	idle;				// Mask of the processors waiting for work
+	uint32_t		nbWakeups[KSMP_NB_CPUS];	// SGIs received
+	uint32_t		nbSleeps[KSMP_NB_CPUS];		// WFIs without work
+};
+
+
+
+
+void		ksmp_init		();
+void		ksmp_start_secondaries	();
+void		ksmp_idle_begin		();
+void		ksmp_idle_end		();
+void		ksmp_idle		();
+void		ksmp_wakeup		();
+void		ksmp_irq		();
+void		ksmp_secondary_main	(uint32_t cpu);
+void		ksmp_get_stats		(struct ksmp_stats *stats);
+
+
+/**
+ * Number of the current processor, from the Multiprocessor Affinity Register.
+ */
+ALWAYS_INLINE
+uint32_t ksmp_cpu()
+{
+	uint32_t mpidr;
+
+	__asm__ __volatile__ ("mrc p15, 0, %0, c0, c0, 5" : "=r" (mpidr));
+	return mpidr & (KSMP_NB_CPUS - 1);
+}
+
+
+ALWAYS_INLINE
+void ksmp_dmb()
+{
+	__asm__ __volatile__ ("dmb" : : : "memory");
+}
+
+
+/**
+ * Atomically replace *ptr by newValue if it is oldValue. Returns true if replaced.
+ */
+ALWAYS_INLINE
+int ksmp_cas(volatile uint32_t *ptr, uint32_t oldValue, uint32_t newValue)
+{
+	uint32_t value, failed;
+
+	do
+	{
+		__asm__ __volatile__ ("ldrex %0, [%1]" : "=&r" (value) : "r" (ptr) : "memory");
+		if (value != oldValue)
+		{
+			__asm__ __volatile__ ("clrex" : : : "memory");
+			return 0;
+		}
+		__asm__ __volatile__ ("strex %0, %2, [%1]" : "=&r" (failed) : "r" (ptr), "r" (newValue) : "memory");
+	} while (failed);
+	return 1;
+}
+
+
+/**
+ * Atomic *ptr |= bits and *ptr &= ~bits. Return the previous value.
+ */
+ALWAYS_INLINE
+uint32_t ksmp_fetch_or(volatile uint32_t *ptr, uint32_t bits)
+{
+	uint32_t value;
+
+	do
+		value = *ptr;
+	while (!ksmp_cas(ptr, value, value | bits));
+	return value;
+}
+
+
+ALWAYS_INLINE
+uint32_t ksmp_fetch_and_not(volatile uint32_t *ptr, uint32_t bits)
+{
+	uint32_t value;
+
+	do
+		value = *ptr;
+	while (!ksmp_cas(ptr, value, value & ~bits));
+	return value;
+}
+
+
+/**
+ * Spinlock, for the short critical sections shared between processors:
+ * to be taken with the interrupts disabled.
+ */
+ALWAYS_INLINE
+void ksmp_lock(volatile uint32_t *lock)
+{
+	while (!ksmp_cas(lock, 0, 1))
+		;
+	ksmp_dmb();
+}
+
+
+ALWAYS_INLINE
+void ksmp_unlock(volatile uint32_t *lock)
+{
+	ksmp_dmb();
+	*lock = 0;
+}
+
+
+
+#endif
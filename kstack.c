@@ -0,0 +1,212 @@
+#include "kstack.h"
+#include "gic.h"
+#include "pl011.h"
+#ifdef CONFIG_MMU
+#include "kmmu.h"
+#endif
+
+
+/**
+ * The pool: each slot is a guard page followed by a stack.
+ */
+static uint8_t kstackPool[KSTACK_NB_STACKS][KSTACK_PAGE_SIZE + KSTACK_SIZE] __attribute__((aligned(KSTACK_PAGE_SIZE)));
+static struct kstack kstackPoolStacks[KSTACK_NB_STACKS];
+
+/**
+ * The fixed stacks of the ldscript.
+ */
+extern uint8_t _sys_stack_bottom[], _sys_stack_top[];
+extern uint8_t _irq_stack_bottom[], _irq_stack_top[];
+extern uint8_t _svc_stack_bottom[], _svc_stack_top[];
+extern uint8_t _abt_stack_bottom[], _abt_stack_top[];
+extern uint8_t _fiq_stack_bottom[], _fiq_stack_top[];
+
+static struct kstack kstackSys, kstackIrq, kstackSvc, kstackAbt, kstackMisc;
+
+static struct kstack *kstackList;
+
+#define KSTACK_FILL_MARGIN	256	// Bytes left below the current SP, when filling the current stack
+
+
+
+
+static void kstack_fill(uint32_t *low, uint32_t *high)
+{
+	while (low < high)
+		*low++ = KSTACK_PATTERN;
+}
+
+
+/**
+ * Current SP.
+ */
+ALWAYS_INLINE
+void* kstack_sp()
+{
+	void *sp;
+
+	__asm__ __volatile__ ("mov %0, sp" : "=r" (sp));
+	return sp;
+}
+
+
+/**
+ * Fill the pool, set its guard pages, and register the fixed stacks.
+ * To be called with the interrupts disabled, before the first exception
+ * that would use the fixed stacks.
+ */
+void kstack_init()
+{
+	uint32_t i;
+
+	for (i=0; i<KSTACK_NB_STACKS; i++)
+	{
+		kstackPoolStacks[i].low		= (uint32_t*)(kstackPool[i] + KSTACK_PAGE_SIZE);
+		kstackPoolStacks[i].size	= KSTACK_SIZE;
+		kstackPoolStacks[i].pooled	= 1;
+		kstackPoolStacks[i].used	= 0;
+	#ifdef CONFIG_MMU
+		kmmu_unmap_page(kstackPool[i]);
+	#else
+		kstack_fill((uint32_t*)kstackPool[i], kstackPoolStacks[i].low);
+	#endif
+	}
+	kstack_register(&kstackSys, "sys", _sys_stack_bottom, _sys_stack_top, 1);
+	kstack_register(&kstackIrq, "irq", _irq_stack_bottom, _irq_stack_top, 0);
+	kstack_register(&kstackSvc, "svc", _svc_stack_bottom, _svc_stack_top, 0);
+	kstack_register(&kstackAbt, "abt", _abt_stack_bottom, _abt_stack_top, 0);
+	kstack_register(&kstackMisc, "fiq/und", _fiq_stack_bottom, _fiq_stack_top, 0);
+}
+
+
+/**
+ * Allocate a stack of KSTACK_SIZE bytes from the pool, filled with the pattern.
+ * NULL if the pool is exhausted.
+ */
+struct kstack* kstack_alloc(const char *name)
+{
+	struct kstack	*stack = NULL;
+	uint32_t	i;
+	int		enabled = arm_disable_interrupts();
+
+	for (i=0; i<KSTACK_NB_STACKS; i++)
+		if (!kstackPoolStacks[i].used)
+		{
+			stack		= &kstackPoolStacks[i];
+			stack->used	= 1;
+			stack->next	= kstackList;
+			kstackList	= stack;
+			break;
+		}
+	if (enabled)
+		arm_enable_interrupts();
+	if (stack == NULL)
+		return NULL;
+
+	stack->name		= name;
+	stack->overflowed	= 0;
+	kstack_fill(stack->low, kstack_top(stack));
+	return stack;
+}
+
+
+void kstack_free(struct kstack *stack)
+{
+	struct kstack	**link;
+	int		enabled = arm_disable_interrupts();
+
+	kstack_check(stack);
+	for (link=&kstackList; *link!=stack; link=&(*link)->next)
+		;
+	*link		= stack->next;
+	stack->used	= 0;
+	if (enabled)
+		arm_enable_interrupts();
+}
+
+
+/**
+ * Register a fixed stack [low, high[ to be measured. The stack is filled with
+ * the pattern, below the current SP (and a margin) if it is the current stack.
+ */
+void kstack_register(struct kstack *stack, const char *name, void *low, void *high, int current)
+{
+	int enabled = arm_disable_interrupts();
+
+	stack->name		= name;
+	stack->low		= (uint32_t*)ALIGN32(low);
+	stack->size		= (uint8_t*)high - (uint8_t*)stack->low;
+	stack->pooled		= 0;
+	stack->used		= 1;
+	stack->overflowed	= 0;
+	kstack_fill(stack->low, current ? (uint32_t*)((uint8_t*)kstack_sp() - KSTACK_FILL_MARGIN) : (uint32_t*)high);
+	stack->next		= kstackList;
+	kstackList		= stack;
+	if (enabled)
+		arm_enable_interrupts();
+}
+
+
+/**
+ * Deepest use of the stack so far, in bytes.
+ */
+uint32_t kstack_high_water(struct kstack *stack)
+{
+	uint32_t *word = stack->low;
+
+	while (word < (uint32_t*)kstack_top(stack) && *word == KSTACK_PATTERN)
+		word++;
+	return (uint8_t*)kstack_top(stack) - (uint8_t*)word;
+}
+
+
+/**
+ * Returns true if the stack overflowed: the lowest word of a fixed stack, or the top
+ * of the guard page of a pool stack (without MMU), is not the pattern anymore.
+ */
+int kstack_check(struct kstack *stack)
+{
+#ifndef CONFIG_MMU
+	uint32_t i;
+#endif
+
+	if (!stack->pooled)
+		stack->overflowed |= (stack->low[0] != KSTACK_PATTERN);
+#ifndef CONFIG_MMU
+	else
+		for (i=1; i<=KSTACK_GUARD_CHECK; i++)
+			stack->overflowed |= (stack->low[-i] != KSTACK_PATTERN);
+#endif
+	return stack->overflowed;
+}
+
+
+struct kstack* kstack_list()
+{
+	return kstackList;
+}
+
+
+/**
+ * Data abort (see _arm_data_abort in gic.s), on the abort stack: if the faulting
+ * address is in a guard page, mark the stack overflowed and report it on UART0,
+ * without kprintf, that would need more stack.
+ */
+void kstack_fault(uint32_t dfsr, uint32_t dfar)
+{
+	struct kstack	*stack;
+	uint32_t	i;
+
+	for (i=0; i<KSTACK_NB_STACKS; i++)
+	{
+		stack = &kstackPoolStacks[i];
+		if (dfar >= (uint32_t)kstackPool[i] && dfar < (uint32_t)stack->low)
+		{
+			stack->overflowed = 1;
+			uart_send_string(UART0, (const unsigned char*)"\n\rstack overflow: ");
+			uart_send_string(UART0, (const unsigned char*)(stack->used ? stack->name : "free stack"));
+			uart_send_string(UART0, (const unsigned char*)"\n\r");
+			return;
+		}
+	}
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) SID LAKHDAR Riyane.
+ *
+ * This code is a patch to the code implemented by Pr Olivier 
+ * Gruber during the Advanced Operating System cours.
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Classpath; see the file COPYING.  If not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA.
+ *
+ */
+
+
+#ifndef KSTACK_H
+#define KSTACK_H
+
+#include "board.h"
+
+
+/**
+ * Stacks: a pool of page-aligned stacks for the threads, and the fixed stacks
+ * of the ldscript, registered to be measured.
+ *
+ * Each stack of the pool lies right above its guard page. With the MMU (CONFIG_MMU),
+ * the guard pages are unmapped: an overflow is a data abort, reported by kstack_fault
+ * on the stack of the abort mode, which is not shared with the other exception modes.
+ * Without the MMU (the default), the guard pages do not guard anything: they are only
+ * filled with the pattern, an overflow writes over them (and below them if deep enough)
+ * unnoticed, and is only detected after the fact, by kstack_check or kstack_list,
+ * when the pattern at the top of the guard page is found damaged.
+ *
+ * The stacks are filled with the pattern when allocated (or registered): the high
+ * water mark of a stack is the depth of the lowest word that is not the pattern anymore.
+ * Stacks may then be sized from measured usage (console stacks command).
+ */
+#define KSTACK_PATTERN		0xDEADBEEF
+#define KSTACK_PAGE_SIZE	4096
+#define KSTACK_SIZE		4096		// Multiple of KSTACK_PAGE_SIZE
+#define KSTACK_NB_STACKS	16
+#define KSTACK_GUARD_CHECK	16		// Words checked at the top of a guard page, without MMU
+
+struct kstack
+{
+	struct kstack		*next;		// In the list of the stacks in use
+	const char		*name;
+	uint32_t		*low;		// Lowest word of the stack
+	uint32_t		size;		// In bytes
+	uint8_t			pooled;		// From the pool, above a guard page
+	uint8_t			used;
+	uint8_t			overflowed;
+};
+
+
+
+
+void		kstack_init		();
+struct kstack*	kstack_alloc		(const char *name);
+void		kstack_free		(struct kstack *stack);
+void		kstack_register		(struct kstack *stack, const char *name, void *low, void *high, int current);
+uint32_t	kstack_high_water	(struct kstack *stack);
+int		kstack_check		(struct kstack *stack);
+struct kstack*	kstack_list		();
+void		kstack_fault		(uint32_t dfsr, uint32_t dfar);
+
+
+/**
+ * The top (initial SP) of a stack.
+ */
+ALWAYS_INLINE
+void* kstack_top(struct kstack *stack)
+{
+	return (uint8_t*)stack->low + stack->size;
+}
+
+
+
+#endif
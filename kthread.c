@@ -0,0 +1,583 @@
+#include "kthread.h"
+#include "kmem.h"
+#include "gic.h"
+#include "kclock.h"
+#include "ktimer.h"
+#include "kevent.h"
+#include "kpmu.h"
+#include "kirqPendingList.h"
+#include "ktrace.h"
+
+
+/**
+ * See gic.s
+ */
+extern void	_kthread_switch		(uint32_t *save, uint32_t sp);
+extern void	_kthread_start		(void);
+void		kthread_start		(kthread_func_t func, void *arg);
+
+
+static struct kthread		kthreadMain;
+static struct kthread		*kthreadCurrent;
+static struct kthread		*kthreadHead;		// Run queue of the ready threads
+static struct kthread		*kthreadTail;
+static struct kthread		*kthreadEdfHead;	// Ready EDF threads, earliest deadline first
+static struct kthread		*kthreadAll;
+static struct kthread		*kthreadZombie;		// Exited, freed by the next thread
+static uint32_t			kthreadNextId;
+static uint64_t			kthreadQuantum;		// Clocksource cycles
+static volatile uint8_t		kthreadNeedResched;
+static uint32_t			kthreadSwitchStart;	// PMU cycles, when the last switch started
+static struct kthread_stats	kthreadStats;
+static uint8_t			kthreadMode;		// Accounting mode of the current thread
+static uint64_t			kthreadModeStart;	// Clocksource cycles, when last charged
+
+
+
+
+/**
+ * The boot context becomes the main thread.
+ */
+void kthread_init()
+{
+	kthreadMain.id		= kthreadNextId++;
+	kthreadMain.name[0]	= 'm';
+	kthreadMain.name[1]	= 'a';
+	kthreadMain.name[2]	= 'i';
+	kthreadMain.name[3]	= 'n';
+	kthreadMain.state	= KTHREAD_RUNNING;
+	kthreadMain.sliceStart	= cycles();
+	kthreadMain.mode	= KTHREAD_MODE_KERNEL;
+	kthreadMode		= KTHREAD_MODE_KERNEL;
+	kthreadModeStart	= kthreadMain.sliceStart;
+	kthreadAll		= &kthreadMain;
+	kthreadCurrent		= &kthreadMain;
+	kthreadQuantum		= kclock_ns_to_cycles(KTHREAD_QUANTUM_NS);
+	kthreadStats.minSwitchCycles = 0xFFFFFFFF;
+}
+
+
+/**
+ * Queue a ready thread: at the tail of the round-robin run queue, or in the
+ * EDF run queue, after the threads of earlier or equal deadline.
+ */
+static void kthread_enqueue(struct kthread *thread)
+{
+	struct kthread **link;
+
+	if (thread->edf)
+	{
+		for (link=&kthreadEdfHead; *link && (*link)->edfParams.absDeadline <= thread->edfParams.absDeadline;
+		     link=&(*link)->next)
+			;
+		thread->next	= *link;
+		*link		= thread;
+		return;
+	}
+	thread->next = NULL;
+	if (kthreadTail)
+		kthreadTail->next = thread;
+	else
+		kthreadHead = thread;
+	kthreadTail = thread;
+}
+
+
+static void kthread_dequeue(struct kthread *thread)
+{
+	struct kthread **link, *prev = NULL;
+
+	for (link=thread->edf ? &kthreadEdfHead : &kthreadHead; *link!=thread; link=&(*link)->next)
+		prev = *link;
+	*link = thread->next;
+	if (!thread->edf && kthreadTail == thread)
+		kthreadTail = prev;
+}
+
+
+/**
+ * Remove from the run queues the next thread to run: the main thread if bottom halves
+ * or events are pending, the ready EDF thread of earliest deadline, or the first ready
+ * round-robin thread. NULL if no thread is ready.
+ */
+static struct kthread *kthread_pick()
+{
+	struct kthread *thread;
+
+	if (kthreadCurrent != &kthreadMain && kthreadMain.state == KTHREAD_READY &&
+	    (getNbPendingIrq() != 0 || kevent_pending()))
+		thread = &kthreadMain;
+	else if (kthreadEdfHead)
+		thread = kthreadEdfHead;
+	else
+		thread = kthreadHead;
+	if (thread == NULL)
+		return NULL;
+	kthread_dequeue(thread);
+	return thread;
+}
+
+
+/**
+ * Charge the cycles elapsed since the last charge to the current thread, in its mode.
+ */
+static void kthread_charge()
+{
+	uint64_t now = cycles();
+
+	kthreadCurrent->cycles[kthreadMode]	+= now - kthreadModeStart;
+	kthreadModeStart			= now;
+}
+
+
+/**
+ * Charge the processor time used since the EDF thread was switched to, to its budget.
+ */
+static void kthread_edf_charge(struct kthread *thread)
+{
+	struct kthread_edf	*edf = &thread->edfParams;
+	uint64_t		now = cycles();
+	uint64_t		used = now - thread->sliceStart;
+
+	edf->remaining		= (used < edf->remaining) ? edf->remaining - used : 0;
+	thread->sliceStart	= now;
+}
+
+
+/**
+ * Account for the switch that has just resumed the current thread.
+ */
+static void kthread_account_switch()
+{
+	uint32_t cost = kpmu_cycles() - kthreadSwitchStart;
+
+	kthreadStats.switchCycles += cost;
+	if (cost < kthreadStats.minSwitchCycles)
+		kthreadStats.minSwitchCycles = cost;
+	if (cost > kthreadStats.maxSwitchCycles)
+		kthreadStats.maxSwitchCycles = cost;
+}
+
+
+/**
+ * Free the thread that exited before the switch to the current thread:
+ * it could not free the stack it was running on.
+ */
+static void kthread_reap()
+{
+	struct kthread **link;
+
+	if (kthreadZombie == NULL)
+		return;
+	for (link=&kthreadAll; *link!=kthreadZombie; link=&(*link)->all)
+		;
+	*link = kthreadZombie->all;
+	kstack_free(kthreadZombie->stack);
+	kfree(kthreadZombie);
+	kthreadZombie = NULL;
+}
+
+
+/**
+ * Switch to the next thread, if any: the current thread goes at the tail of the
+ * run queue, unless it exited. Returns once the current thread is switched back,
+ * true if there was a switch.
+ * Must be called with the interrupts disabled.
+ */
+static int kthread_schedule()
+{
+	struct kthread *prev = kthreadCurrent;
+	struct kthread *next = kthread_pick();
+
+	kthreadNeedResched = 0;
+	if (next == NULL)
+		return 0;
+	if (prev->edf)
+		kthread_edf_charge(prev);
+	kthread_charge();
+	prev->mode	= kthreadMode;
+	kthreadMode	= next->mode;
+	if (prev->state == KTHREAD_EXITED)
+		kthreadZombie = prev;
+	else if (prev->state == KTHREAD_RUNNING)
+	{
+		prev->state = KTHREAD_READY;
+		kthread_enqueue(prev);
+	}
+	next->state		= KTHREAD_RUNNING;
+	next->sliceStart	= cycles();
+	next->nbSwitches++;
+	kthreadCurrent		= next;
+	kvfp_switch(next);
+	if (next != &kthreadMain)
+		ktimer_busy();
+
+	kthreadStats.nbSwitches++;
+	TRACE_INSTANT(KTRACE_SWITCH, prev->id << 16 | next->id);
+	kthreadSwitchStart = kpmu_cycles();
+	_kthread_switch(&prev->sp, next->sp);
+
+	kthread_account_switch();
+	kthread_reap();
+	return 1;
+}
+
+
+/**
+ * First run of a thread, from _kthread_start (gic.s), with the interrupts disabled.
+ */
+void kthread_start(kthread_func_t func, void *arg)
+{
+	kthread_account_switch();
+	kthread_reap();
+	arm_enable_interrupts();
+	func(arg);
+	kthread_exit();
+}
+
+
+/**
+ * Returns true if the running thread is an EDF thread, and a ready EDF thread
+ * has an earlier absolute deadline: the running one is to be preempted.
+ */
+static int kthread_edf_preempts(struct kthread *current)
+{
+	return current && current->edf && kthreadEdfHead &&
+		kthreadEdfHead->edfParams.absDeadline < current->edfParams.absDeadline;
+}
+
+
+/**
+ * Release timer of an EDF thread, from the timer bottom: start the next job, with
+ * a new budget and deadline. The previous job missed its deadline if not completed.
+ */
+static void kthread_edf_release(struct ktimer *timer, void *arg)
+{
+	struct kthread		*thread = (struct kthread*)arg;
+	struct kthread_edf	*edf = &thread->edfParams;
+	int			enabled = arm_disable_interrupts();
+
+	if (thread->state != KTHREAD_WAITING)
+		edf->nbMisses++;
+	if (thread->state == KTHREAD_READY)
+		kthread_dequeue(thread);
+	else if (thread->state == KTHREAD_RUNNING)
+		thread->sliceStart = cycles();
+	edf->release		+= edf->period;
+	edf->absDeadline	= edf->release + edf->deadline;
+	edf->remaining		= edf->budget;
+	if (thread->state != KTHREAD_RUNNING)
+	{
+		thread->state = KTHREAD_READY;
+		kthread_enqueue(thread);
+	}
+	if (kthread_edf_preempts(kthreadCurrent))
+		kthreadNeedResched = 1;
+	ktimer_add(timer, (edf->release + edf->period) >> KTIMER_JIFFY_SHIFT);
+
+	if (enabled)
+		arm_enable_interrupts();
+}
+
+
+/**
+ * Create a thread, ready to run func(arg) on its own stack, EDF if parameters are given.
+ * The initial stack is the frame popped by _kthread_switch: CPSR (SYS mode,
+ * interrupts disabled), r4=func, r5=arg, r6-r11, and LR=_kthread_start.
+ */
+static struct kthread* kthread_new(const char *name, kthread_func_t func, void *arg, struct kthread_edf *edf)
+{
+	struct kthread	*thread;
+	uint32_t	*sp;
+	uint32_t	i;
+	int		enabled = arm_disable_interrupts();
+
+	thread		= kmalloc(sizeof(struct kthread));
+	if (thread == NULL)
+	{
+		if (enabled)
+			arm_enable_interrupts();
+		return NULL;
+	}
+	thread->stack	= kstack_alloc(name);
+	if (thread->stack == NULL)
+	{
+		kfree(thread);
+		if (enabled)
+			arm_enable_interrupts();
+		return NULL;
+	}
+
+	sp	= (uint32_t*)((uintptr_t)kstack_top(thread->stack) & ~7);
+	sp	-= 10;
+	sp[0]	= CPSR_SYS_MODE | CPSR_IRQ_FLAG | CPSR_FIQ_FLAG;
+	sp[1]	= (uint32_t)func;
+	sp[2]	= (uint32_t)arg;
+	for (i=3; i<9; i++)
+		sp[i] = 0;
+	sp[9]	= (uint32_t)_kthread_start;
+
+	thread->sp		= (uint32_t)sp;
+	thread->id		= kthreadNextId++;
+	for (i=0; i<KTHREAD_NAME_SIZE-1 && name[i]; i++)
+		thread->name[i] = name[i];
+	thread->name[i]		= 0;
+	thread->stack->name	= thread->name;
+	thread->state		= KTHREAD_READY;
+	thread->func		= func;
+	thread->arg		= arg;
+	thread->nbSwitches	= 0;
+	thread->nbPreemptions	= 0;
+	for (i=0; i<KVFP_NB_DREGS; i++)
+		thread->vfp.d[i] = 0;
+	thread->vfp.fpscr	= 0;
+	for (i=0; i<KTHREAD_NB_MODES; i++)
+		thread->cycles[i] = 0;
+	thread->mode		= KTHREAD_MODE_KERNEL;
+	thread->edf		= (edf != NULL);
+	if (edf)
+	{
+		thread->edfParams		= *edf;
+		thread->edfParams.release	= cycles();
+		thread->edfParams.absDeadline	= thread->edfParams.release + edf->deadline;
+		thread->edfParams.remaining	= edf->budget;
+		ktimer_setup(&thread->edfParams.timer, kthread_edf_release, thread);
+		ktimer_add(&thread->edfParams.timer, (thread->edfParams.release + edf->period) >> KTIMER_JIFFY_SHIFT);
+	}
+	thread->all		= kthreadAll;
+	kthreadAll		= thread;
+	kthread_enqueue(thread);
+
+	if (enabled)
+		arm_enable_interrupts();
+	return thread;
+}
+
+
+struct kthread* kthread_create(const char *name, kthread_func_t func, void *arg)
+{
+	return kthread_new(name, func, arg, NULL);
+}
+
+
+/**
+ * Create an EDF thread, with its period, budget and relative deadline in nanoseconds
+ * (a deadline of 0 is the period). Its first job is released at once.
+ * Returns NULL if the thread is not admitted.
+ */
+struct kthread* kthread_create_edf(const char *name, kthread_func_t func, void *arg,
+				   uint64_t period, uint64_t budget, uint64_t deadline)
+{
+	struct kthread_edf	edf;
+	struct kthread		*thread;
+	uint64_t		window;
+	int			enabled;
+
+	if (deadline == 0)
+		deadline = period;
+	window = (deadline < period) ? deadline : period;
+	if (budget == 0 || budget > window)
+		return NULL;
+	edf.period	= kclock_ns_to_cycles(period);
+	edf.budget	= kclock_ns_to_cycles(budget);
+	edf.deadline	= kclock_ns_to_cycles(deadline);
+	edf.load	= (uint32_t)(budget * KTHREAD_EDF_LOAD_ONE / window);
+	edf.nbJobs	= 0;
+	edf.nbMisses	= 0;
+	edf.nbThrottles	= 0;
+
+	enabled = arm_disable_interrupts();
+	if (kthreadStats.edfLoad + edf.load > KTHREAD_EDF_MAX_LOAD)
+	{
+		kthreadStats.nbEdfRejected++;
+		thread = NULL;
+	}
+	else
+	{
+		thread = kthread_new(name, func, arg, &edf);
+		if (thread)
+			kthreadStats.edfLoad += edf.load;
+	}
+	if (enabled)
+		arm_enable_interrupts();
+	return thread;
+}
+
+
+/**
+ * End of the job of the current EDF thread: wait for the release of the next one.
+ */
+void kthread_edf_wait()
+{
+	struct kthread	*thread = kthreadCurrent;
+	int		enabled = arm_disable_interrupts();
+
+	thread->edfParams.nbJobs++;
+	if (cycles() > thread->edfParams.absDeadline)
+		thread->edfParams.nbMisses++;
+	thread->state = KTHREAD_WAITING;
+	kthread_schedule();
+	if (enabled)
+		arm_enable_interrupts();
+}
+
+
+struct kthread* kthread_self()
+{
+	return kthreadCurrent;
+}
+
+
+/**
+ * Let the next ready thread run. Returns true if another thread ran meanwhile.
+ */
+int kthread_yield()
+{
+	int enabled = arm_disable_interrupts();
+	int switched;
+
+	kthreadStats.nbYields++;
+	switched = kthread_schedule();
+	if (enabled)
+		arm_enable_interrupts();
+	return switched;
+}
+
+
+/**
+ * Terminate the current thread, which must not be the main thread.
+ */
+void kthread_exit()
+{
+	arm_disable_interrupts();
+	kvfp_release(kthreadCurrent);
+	if (kthreadCurrent->edf)
+	{
+		ktimer_cancel(&kthreadCurrent->edfParams.timer);
+		kthreadStats.edfLoad -= kthreadCurrent->edfParams.load;
+	}
+	kthreadCurrent->state = KTHREAD_EXITED;
+	kthread_schedule();
+	panic(666, "exited thread switched back\n\r");
+}
+
+
+/**
+ * Called from the top half of the private timer: request the preemption of the current
+ * thread when it is an EDF thread that has consumed its budget (it is throttled until
+ * its next release), when it is a round-robin thread and an EDF thread is ready, or at
+ * the end of its quantum if another round-robin thread is ready. The main thread is not
+ * preempted by EDF threads while bottom halves or events are pending.
+ */
+void kthread_tick()
+{
+	struct kthread	*thread = kthreadCurrent;
+	uint64_t	used;
+
+	if (thread == NULL)
+		return;
+	used = cycles() - thread->sliceStart;
+	if (thread->edf)
+	{
+		if (used >= thread->edfParams.remaining)
+		{
+			thread->state = KTHREAD_THROTTLED;
+			thread->edfParams.nbThrottles++;
+			kthreadNeedResched = 1;
+		}
+		else if (kthread_edf_preempts(thread))
+			kthreadNeedResched = 1;
+	}
+	else if (kthreadEdfHead)
+	{
+		if (thread != &kthreadMain || (getNbPendingIrq() == 0 && !kevent_pending()))
+			kthreadNeedResched = 1;
+	}
+	else if (kthreadHead && used >= kthreadQuantum)
+		kthreadNeedResched = 1;
+}
+
+
+/**
+ * Called by _arm_irq_handler (gic.s) after irq_handler, with the interrupts disabled:
+ * preempt the current thread if its quantum has expired, or if bottom halves or events
+ * are pending for the main thread.
+ */
+void kthread_irq_exit()
+{
+	if (kthreadCurrent == NULL)
+		return;
+#ifdef CONFIG_SMP
+	if (ksmp_cpu() != 0)
+		return;
+#endif
+	if (kthreadCurrent != &kthreadMain && (getNbPendingIrq() != 0 || kevent_pending()))
+		kthreadNeedResched = 1;
+	if (kthreadNeedResched)
+	{
+		arm_disable_interrupts();
+		kthreadCurrent->nbPreemptions++;
+		kthreadStats.nbPreemptions++;
+		kthread_schedule();
+	}
+}
+
+
+struct kthread* kthread_list()
+{
+	return kthreadAll;
+}
+
+
+/**
+ * Change the accounting mode of the current thread, after charging it the cycles
+ * elapsed in the previous mode, which is returned to be restored.
+ */
+uint32_t kthread_mode_enter(uint32_t mode)
+{
+	uint32_t	prev = kthreadMode;
+	int		enabled;
+
+	if (kthreadCurrent == NULL)
+		return prev;
+#ifdef CONFIG_SMP
+	if (ksmp_cpu() != 0)
+		return prev;
+#endif
+	enabled = arm_disable_interrupts();
+	kthread_charge();
+	kthreadMode = mode;
+	if (enabled)
+		arm_enable_interrupts();
+	return prev;
+}
+
+
+/**
+ * Processor time of the given thread (or KTHREAD_SELF), in cycles per mode,
+ * up to date for the current thread. Returns false if there is no such thread.
+ */
+int kthread_times(uint32_t id, uint64_t cycles[KTHREAD_NB_MODES])
+{
+	struct kthread	*thread;
+	uint32_t	i;
+	int		enabled = arm_disable_interrupts();
+
+	if (kthreadCurrent)
+		kthread_charge();
+	for (thread=kthreadAll; thread; thread=thread->all)
+		if (id == thread->id || (id == KTHREAD_SELF && thread == kthreadCurrent))
+			break;
+	if (thread)
+		for (i=0; i<KTHREAD_NB_MODES; i++)
+			cycles[i] = thread->cycles[i];
+	if (enabled)
+		arm_enable_interrupts();
+	return thread != NULL;
+}
+
+
+void kthread_get_stats(struct kthread_stats *stats)
+{
+	*stats = kthreadStats;
+}
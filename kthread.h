@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) SID LAKHDAR Riyane.
+ *
+ * This code is a patch to the code implemented by Pr Olivier 
+ * Gruber during the Advanced Operating System cours.
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Classpath; see the file COPYING.  If not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA.
+ *
+ */
+
+
+#ifndef KTHREAD_H
+#define KTHREAD_H
+
+#include "board.h"
+#include "kvfp.h"
+#include "kstack.h"
+#include "ktimer.h"
+
+
+/**
+ * Preemptive round-robin kernel threads.
+ *
+ * Each thread runs in SYS mode on its own C stack. The boot context, running the
+ * kmain loop (bottom halves and events), is the main thread: it is preferred as soon
+ * as bottom halves or events are pending, and it yields to the other threads when it
+ * has nothing to do, instead of waiting for an interrupt.
+ *
+ * The context switch (_kthread_switch, gic.s) pushes the CPSR, the callee-saved
+ * registers and LR on the stack of the current thread, saves its SP in the thread,
+ * and pops the same from the stack of the next thread: the caller-saved registers
+ * are saved by the caller, per the AAPCS. A preempted thread is switched from the
+ * IRQ exit path: its interrupted state (caller-saved registers, PC and SPSR, see
+ * struct irq_frame) is already on its own stack, and is restored by the IRQ return
+ * once the thread is switched back.
+ *
+ * The running thread is preempted once it has run for a quantum, checked on each
+ * interrupt of the private timer: in tickless mode, the periodic tick is restarted
+ * as long as threads run (see ktimer_busy).
+ *
+ * The FP unit is switched lazily (see kvfp.h): the switch only disables it.
+ *
+ * The cost of each switch, from the save of the current thread to the restore of
+ * the next one, is measured in processor cycles with the PMU cycle counter.
+ *
+ * Earliest-deadline-first (EDF) threads (kthread_create_edf) run periodic jobs:
+ * each period, a job is released with a budget of processor time and an absolute
+ * deadline; the job ends when the thread calls kthread_edf_wait. Ready EDF threads
+ * run before the round-robin ones, earliest deadline first, the main thread still
+ * being preferred when bottom halves or events are pending.
+ * - Admission control: a thread is rejected if the total density (budget over the
+ *   smaller of deadline and period) of the EDF threads would exceed KTHREAD_EDF_MAX_LOAD.
+ * - Budget enforcement: the private timer tick throttles a job that has consumed its
+ *   budget, until its next release.
+ * - Preemption: a running job is preempted as soon as a job with an earlier absolute
+ *   deadline is released (or, at the latest, on the next tick).
+ * - A deadline is missed when a job completes after its deadline, or when it is not
+ *   completed at its next release (it then goes on, with the next budget and deadline).
+ * The releases are timers (see ktimer.h): their precision is a jiffy.
+ *
+ * The processor time is accounted per thread, in clocksource cycles, split by mode:
+ * kernel, user (USR mode code), interrupt (top halves) and idle (spinning or waiting
+ * for an interrupt, see kidle.h). Each mode change (kthread_mode_enter: IRQ entry and
+ * exit, system calls, user entry and exit, idle) and each switch charges the cycles
+ * elapsed since the last one to the current (outgoing) thread, in the mode it was in.
+ * A switched out thread keeps its mode, restored when it is switched back.
+ * Only the boot processor, which runs the threads, is accounted.
+ */
+#define KTHREAD_QUANTUM_NS	10000000	// 10ms
+#define KTHREAD_NAME_SIZE	16
+
+#define KTHREAD_READY		0
+#define KTHREAD_RUNNING		1
+#define KTHREAD_EXITED		2
+#define KTHREAD_WAITING		3	// EDF: job completed, until the next release
+#define KTHREAD_THROTTLED	4	// EDF: budget consumed, until the next release
+
+#define KTHREAD_MODE_KERNEL	0
+#define KTHREAD_MODE_USER	1
+#define KTHREAD_MODE_IRQ	2
+#define KTHREAD_MODE_IDLE	3
+#define KTHREAD_NB_MODES	4
+
+#define KTHREAD_SELF		0xFFFFFFFF	// Thread id of the current thread, see kthread_times
+
+#define KTHREAD_EDF_LOAD_ONE	1024		// Fixed point density of a fully used processor
+#define KTHREAD_EDF_MAX_LOAD	(KTHREAD_EDF_LOAD_ONE * 9 / 10)
+
+
+typedef void (*kthread_func_t)(void *arg);
+
+struct kthread_edf
+{
+	uint64_t		period;		// Clocksource cycles
+	uint64_t		budget;
+	uint64_t		deadline;	// Relative to the release
+	uint64_t		release;	// Of the current job
+	uint64_t		absDeadline;	// Of the current job
+	uint64_t		remaining;	// Budget left to the current job
+	uint32_t		load;		// Density, see KTHREAD_EDF_LOAD_ONE
+	uint32_t		nbJobs;		// Completed
+	uint32_t		nbMisses;
+	uint32_t		nbThrottles;
+	struct ktimer		timer;		// Next release
+};
+
+struct kthread
+{
+	uint32_t		sp;		// Saved SP, when not running (first field, see gic.s)
+	struct kthread		*next;		// Run queue
+	struct kthread		*all;		// All the threads
+	uint32_t		id;
+	char			name[KTHREAD_NAME_SIZE];
+	uint8_t			state;
+	kthread_func_t		func;
+	void			*arg;
+	struct kstack		*stack;		// From the stack pool, NULL for the main thread
+	uint64_t		sliceStart;	// Clocksource cycles, when switched to
+	uint32_t		nbSwitches;	// Switched to
+	uint32_t		nbPreemptions;	// Preempted at the end of its quantum
+	struct kvfp_state	vfp;		// FP registers, when not in the FP unit
+	uint64_t		cycles[KTHREAD_NB_MODES];	// Processor time, per mode
+	uint8_t			mode;		// Accounting mode, when switched out
+	uint8_t			edf;		// EDF thread, round-robin otherwise
+	struct kthread_edf	edfParams;
+};
+
+struct kthread_stats
+{
+	uint32_t		nbSwitches;
+	uint32_t		nbPreemptions;
+	uint32_t		nbYields;
+	uint64_t		switchCycles;	// Total cost of the switches
+	uint32_t		minSwitchCycles;
+	uint32_t		maxSwitchCycles;
+	uint32_t		edfLoad;	// Admitted density, see KTHREAD_EDF_LOAD_ONE
+	uint32_t		nbEdfRejected;
+};
+
+
+
+
+void		kthread_init		();
+struct kthread*	kthread_create		(const char *name, kthread_func_t func, void *arg);
+struct kthread*	kthread_create_edf	(const char *name, kthread_func_t func, void *arg,
+					 uint64_t period, uint64_t budget, uint64_t deadline);
+void		kthread_edf_wait	();
+struct kthread*	kthread_self		();
+int		kthread_yield		();
+void		kthread_exit		();
+void		kthread_tick		();
+void		kthread_irq_exit	();
+struct kthread*	kthread_list		();
+uint32_t	kthread_mode_enter	(uint32_t mode);
+int		kthread_times		(uint32_t id, uint64_t cycles[KTHREAD_NB_MODES]);
+void		kthread_get_stats	(struct kthread_stats *stats);
+
+
+
+#endif
@@ -0,0 +1,471 @@
+#include "ktimer.h"
+#include "timer.h"
+#include "gic.h"
+#include "klatency.h"
+#include "ktrace.h"
+
+
+/**
+ * The wheel: a list of timers per slot, and a bitmap per level of the non empty slots.
+ * clk is the next jiffy to be processed, all the timers expiring before clk have expired.
+ * The timers of the slot being expired are moved to the expiring list, from which
+ * they can still be canceled by the callbacks of the timers expired before them.
+ */
+#define KTIMER_LEVEL_EXPIRING	KTIMER_NB_LEVELS
+
+static struct
+{
+	struct ktimer		*slots[KTIMER_NB_LEVELS][KTIMER_NB_SLOTS];
+	struct ktimer		*expiring;
+	uint64_t		occupancy[KTIMER_NB_LEVELS];
+	uint64_t		clk;
+	volatile uint8_t	bottomPending;
+	uint8_t			busy;		// Tickless: periodic tick restarted by ktimer_busy
+	struct ktimer_stats	stats;
+} ktimerWheel;
+
+
+
+
+/**
+ * Circular distance from the slot "from" to the first non empty slot of the level,
+ * -1 if the level is empty.
+ */
+static int ktimer_find_slot(uint32_t level, uint32_t from)
+{
+	uint64_t map = ktimerWheel.occupancy[level];
+
+	if (map == 0)
+		return -1;
+	if (from)
+		map = (map >> from) | (map << (KTIMER_NB_SLOTS - from));
+	if ((uint32_t)map)
+		return __builtin_ctz((uint32_t)map);
+	return 32 + __builtin_ctz((uint32_t)(map >> 32));
+}
+
+
+/**
+ * Link the timer in the slot of its expiry, relative to the current jiffy of the wheel.
+ * Must be called with the interrupts disabled.
+ */
+static void ktimer_enqueue(struct ktimer *timer)
+{
+	uint64_t	expires	= timer->expires;
+	uint64_t	delta;
+	uint32_t	level, slot;
+
+	if (expires < ktimerWheel.clk)
+		expires = ktimerWheel.clk;
+	delta = expires - ktimerWheel.clk;
+	if (delta > KTIMER_MAX_DELAY)
+	{
+		expires	= ktimerWheel.clk + KTIMER_MAX_DELAY;
+		delta	= KTIMER_MAX_DELAY;
+	}
+	for (level=0; level<KTIMER_NB_LEVELS-1; level++)
+	{
+		if (delta < (1ULL << (KTIMER_SLOT_BITS * (level+1))))
+			break;
+	}
+	slot = (expires >> (KTIMER_SLOT_BITS * level)) & KTIMER_SLOT_MASK;
+
+	timer->level	= level;
+	timer->slot	= slot;
+	timer->prev	= NULL;
+	timer->next	= ktimerWheel.slots[level][slot];
+	if (timer->next)
+		timer->next->prev = timer;
+	ktimerWheel.slots[level][slot]	= timer;
+	ktimerWheel.occupancy[level]	|= (1ULL << slot);
+}
+
+
+/**
+ * Must be called with the interrupts disabled.
+ */
+static void ktimer_dequeue(struct ktimer *timer)
+{
+	struct ktimer **head;
+
+	if (timer->level == KTIMER_LEVEL_EXPIRING)
+		head = &ktimerWheel.expiring;
+	else
+		head = &ktimerWheel.slots[timer->level][timer->slot];
+	if (timer->prev)
+		timer->prev->next = timer->next;
+	else
+		*head = timer->next;
+	if (timer->next)
+		timer->next->prev = timer->prev;
+	if (timer->level != KTIMER_LEVEL_EXPIRING && *head == NULL)
+		ktimerWheel.occupancy[timer->level] &= ~(1ULL << timer->slot);
+}
+
+
+/**
+ * Round the expiry up within the slack window: keep the bits of the end of the
+ * window above the highest bit that differs from the expiry, and clear the others.
+ */
+static uint64_t ktimer_apply_slack(uint64_t expires, uint32_t slack)
+{
+	uint64_t	limit = expires + slack;
+	uint64_t	mask = expires ^ limit;
+	uint32_t	bit;
+
+	if (mask == 0)
+		return expires;
+	if (mask >> 32)
+		bit = 63 - __builtin_clz((uint32_t)(mask >> 32));
+	else
+		bit = 31 - __builtin_clz((uint32_t)mask);
+	return limit & ~((1ULL << bit) - 1);
+}
+
+
+/**
+ * Remove all the timers of the slot, and return them as a list.
+ * Must be called with the interrupts disabled.
+ */
+static struct ktimer *ktimer_detach_slot(uint32_t level, uint32_t slot)
+{
+	struct ktimer *list = ktimerWheel.slots[level][slot];
+
+	ktimerWheel.slots[level][slot]	= NULL;
+	ktimerWheel.occupancy[level]	&= ~(1ULL << slot);
+	return list;
+}
+
+
+/**
+ * Move the timers of the current slot of the upper levels to the lower levels.
+ * Called each time the level 0 wraps, the level l+1 is cascaded only when the level l wraps.
+ * Must be called with the interrupts disabled.
+ */
+static void ktimer_cascade()
+{
+	struct ktimer	*list, *next;
+	uint32_t	level, slot;
+
+	for (level=1; level<KTIMER_NB_LEVELS; level++)
+	{
+		slot = (ktimerWheel.clk >> (KTIMER_SLOT_BITS * level)) & KTIMER_SLOT_MASK;
+		for (list=ktimer_detach_slot(level, slot); list; list=next)
+		{
+			next = list->next;
+			ktimer_enqueue(list);
+			ktimerWheel.stats.nbCascaded++;
+		}
+		if (slot != 0)
+			break;
+	}
+}
+
+
+/**
+ * Move the wheel forward, by no more than the next wrap of the level 0.
+ * The cascade is done as soon as the level 0 wraps, so that the timers are always
+ * queued relative to a wheel where the current slots of all the levels are empty.
+ * Must be called with the interrupts disabled.
+ */
+static void ktimer_advance(uint32_t nbJiffies)
+{
+	ktimerWheel.clk += nbJiffies;
+	if ((ktimerWheel.clk & KTIMER_SLOT_MASK) == 0)
+		ktimer_cascade();
+}
+
+
+/**
+ * Expire all the timers up to the current jiffy, including the jiffies elapsed
+ * while running the callbacks.
+ * The empty slots are skipped, up to the next wrap of the level 0 (where the cascade happens).
+ * The callbacks are upcalled with the interrupts enabled, they may add or cancel timers.
+ * The bottom half is left requested until the end, so that it is not run again,
+ * from the interrupt handler emptying the pending list, while running the callbacks:
+ * the expiring list is shared.
+ */
+static void ktimer_run()
+{
+	struct ktimer	*list, *timer;
+	uint64_t	now;
+	uint32_t	slot, advance, nbTimers, nbDelayed;
+	int		d, enabled;
+
+	enabled = arm_disable_interrupts();
+	while (ktimerWheel.clk <= (now = jiffies()))
+	{
+		slot	= ktimerWheel.clk & KTIMER_SLOT_MASK;
+		d	= ktimer_find_slot(0, slot);
+		if (d != 0)
+		{
+			if (d < 0 || slot + d >= KTIMER_NB_SLOTS)
+				advance = KTIMER_NB_SLOTS - slot;
+			else
+				advance = d;
+			if (ktimerWheel.clk + advance > now + 1)
+				advance = now + 1 - ktimerWheel.clk;
+			ktimer_advance(advance);
+			continue;
+		}
+
+		/*
+		* The timers of the slot expire with a single wakeup: each timer delayed
+		* by its slack to share it with the others saved a wakeup.
+		*/
+		list = ktimer_detach_slot(0, slot);
+		ktimer_advance(1);
+		nbTimers = nbDelayed = 0;
+		for (timer=list; timer; timer=timer->next)
+		{
+			timer->level = KTIMER_LEVEL_EXPIRING;
+			nbTimers++;
+			if (timer->expires != timer->requested)
+				nbDelayed++;
+		}
+		ktimerWheel.stats.nbSaved += (nbDelayed < nbTimers) ? nbDelayed : nbTimers - 1;
+		ktimerWheel.expiring = list;
+
+		while ((timer = ktimerWheel.expiring) != NULL)
+		{
+			ktimerWheel.expiring = timer->next;
+			if (timer->next)
+				timer->next->prev = NULL;
+			timer->pending = 0;
+			ktimerWheel.stats.nbPending--;
+			ktimerWheel.stats.nbExpired++;
+			if (enabled)
+				arm_enable_interrupts();
+			LATENCY_BEGIN(callback, KLATENCY_TIMER, TIMER_PRIVATE_IRQ, timer->func);
+			TRACE_BEGIN(KTRACE_TIMER, timer->func);
+			timer->func(timer, timer->arg);
+			TRACE_END(KTRACE_TIMER, timer->func);
+			LATENCY_END(callback);
+			arm_disable_interrupts();
+		}
+	}
+	ktimerWheel.bottomPending = 0;
+	if (enabled)
+		arm_enable_interrupts();
+}
+
+
+
+
+/**
+ * Start the wheel at the current jiffy, and the periodic tick of the hardware timer
+ * unless in tickless mode: the hardware timer is then programmed when going idle.
+ */
+void ktimer_init()
+{
+	uint32_t level, slot;
+
+	for (level=0; level<KTIMER_NB_LEVELS; level++)
+	{
+		for (slot=0; slot<KTIMER_NB_SLOTS; slot++)
+			ktimerWheel.slots[level][slot] = NULL;
+		ktimerWheel.occupancy[level] = 0;
+	}
+	ktimerWheel.clk			= jiffies();
+	ktimerWheel.bottomPending	= 0;
+
+	/*
+	* No prescaler: the private timer counts PERIPHCLK cycles, as the clocksource.
+	*/
+	timer_init(0);
+#ifndef CONFIG_TICKLESS
+	timer_arm_periodic(1 << KTIMER_JIFFY_SHIFT);
+#endif
+}
+
+
+void ktimer_setup(struct ktimer *timer, ktimer_func_t func, void *arg)
+{
+	timer->next	= NULL;
+	timer->prev	= NULL;
+	timer->func	= func;
+	timer->arg	= arg;
+	timer->slack	= 0;
+	timer->pending	= 0;
+}
+
+
+/**
+ * Let the timer expire up to slack nanoseconds late (rounded down to jiffies),
+ * so that it may share its wakeup with other timers. Applies from the next add.
+ */
+void ktimer_set_slack(struct ktimer *timer, uint64_t slack)
+{
+	timer->slack = (uint32_t)(kclock_ns_to_cycles(slack) >> KTIMER_JIFFY_SHIFT);
+}
+
+
+/**
+ * Arm the timer to expire at the given jiffy, or re-arm it if it is already pending.
+ * An empty wheel is first moved forward to the current jiffy: in tickless mode,
+ * it is not run while idle, and its jiffy may be far behind after a long idle.
+ * All its slots being empty, there is nothing to expire nor to cascade.
+ */
+void ktimer_add(struct ktimer *timer, uint64_t expires)
+{
+	uint64_t	now;
+	int		enabled = arm_disable_interrupts();
+
+	if (timer->pending)
+		ktimer_dequeue(timer);
+	else
+	{
+		now = jiffies();
+		if (ktimerWheel.stats.nbPending == 0 && ktimerWheel.clk < now)
+			ktimerWheel.clk = now;
+		ktimerWheel.stats.nbPending++;
+	}
+	timer->requested	= expires;
+	timer->expires		= ktimer_apply_slack(expires, timer->slack);
+	timer->pending		= 1;
+	ktimer_enqueue(timer);
+	ktimerWheel.stats.nbAdded++;
+	if (enabled)
+		arm_enable_interrupts();
+}
+
+
+/**
+ * Arm the timer to expire in delay nanoseconds (rounded up to the next jiffy).
+ * The current jiffy is already partly elapsed: one more jiffy is added, so that
+ * the timer never expires early.
+ */
+void ktimer_add_ns(struct ktimer *timer, uint64_t delay)
+{
+	ktimer_add(timer, jiffies() + ktimer_ns_to_jiffies(delay) + 1);
+}
+
+
+/**
+ * Returns true if the timer was pending.
+ */
+int ktimer_cancel(struct ktimer *timer)
+{
+	int enabled = arm_disable_interrupts();
+	int pending = timer->pending;
+
+	if (pending)
+	{
+		ktimer_dequeue(timer);
+		timer->pending = 0;
+		ktimerWheel.stats.nbPending--;
+		ktimerWheel.stats.nbCanceled++;
+	}
+	if (enabled)
+		arm_enable_interrupts();
+	return pending;
+}
+
+
+/**
+ * Top half, called from the interrupt handler for the timer IRQ.
+ * Returns true if the bottom half must be scheduled.
+ */
+int ktimer_irq()
+{
+	timer_ack();
+	ktimerWheel.stats.nbTicks++;
+	if (ktimerWheel.bottomPending)
+		return 0;
+	ktimerWheel.bottomPending = 1;
+	return 1;
+}
+
+
+/**
+ * Bottom half, expires the timers (see ktimer_run for the end of the request).
+ */
+void ktimer_bottom()
+{
+	ktimer_run();
+}
+
+
+/**
+ * Jiffy of the earliest timer, or of the earliest cascade of an upper level
+ * (the timers of the upper levels have a coarser expiry), KTIMER_NO_DEADLINE
+ * if there is no pending timer.
+ */
+uint64_t ktimer_next_deadline()
+{
+	uint64_t	deadline = KTIMER_NO_DEADLINE;
+	uint64_t	upper, t;
+	uint32_t	level, shift;
+	int		d, enabled;
+
+	enabled = arm_disable_interrupts();
+	d = ktimer_find_slot(0, ktimerWheel.clk & KTIMER_SLOT_MASK);
+	if (d >= 0)
+		deadline = ktimerWheel.clk + d;
+	for (level=1; level<KTIMER_NB_LEVELS; level++)
+	{
+		shift	= KTIMER_SLOT_BITS * level;
+		upper	= ktimerWheel.clk >> shift;
+		d	= ktimer_find_slot(level, (upper + 1) & KTIMER_SLOT_MASK);
+		if (d < 0)
+			continue;
+		t = (upper + 1 + d) << shift;
+		if (t < deadline)
+			deadline = t;
+	}
+	if (enabled)
+		arm_enable_interrupts();
+	return deadline;
+}
+
+
+/**
+ * Tickless idle: program the hardware timer as a one-shot for the next deadline,
+ * or stop it if there is no pending timer. A deadline already passed fires at once.
+ * Delays beyond the range of the hardware timer are cut, the wheel is then
+ * simply re-evaluated on the next idle.
+ * Must be called with the interrupts disabled, right before waiting for an interrupt.
+ */
+void ktimer_idle()
+{
+	uint64_t	deadline = ktimer_next_deadline();
+	int64_t		delay;
+
+	ktimerWheel.busy = 0;
+	if (deadline == KTIMER_NO_DEADLINE)
+	{
+		timer_disarm();
+		ktimerWheel.stats.nbIdleStops++;
+		return;
+	}
+	delay = (int64_t)((deadline << KTIMER_JIFFY_SHIFT) - cycles());
+	if (delay <= 0)
+		delay = 1;
+	else if (delay > 0xFFFFFFFF)
+		delay = 0xFFFFFFFF;
+	timer_arm_oneshot((uint32_t)delay);
+	ktimerWheel.stats.nbIdles++;
+}
+
+
+/**
+ * Tickless mode: restart the periodic tick, until the next idle, while the processor
+ * is kept busy by threads rather than by the main loop, so that the timers expire
+ * and the quantum of the threads is checked. Nothing to do with the periodic tick.
+ * Must be called with the interrupts disabled.
+ */
+void ktimer_busy()
+{
+#ifdef CONFIG_TICKLESS
+	if (ktimerWheel.busy)
+		return;
+	ktimerWheel.busy = 1;
+	timer_arm_periodic(1 << KTIMER_JIFFY_SHIFT);
+#endif
+}
+
+
+void ktimer_get_stats(struct ktimer_stats *stats)
+{
+	*stats = ktimerWheel.stats;
+}
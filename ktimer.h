@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) SID LAKHDAR Riyane.
+ *
+ * This code is a patch to the code implemented by Pr Olivier 
+ * Gruber during the Advanced Operating System cours.
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Classpath; see the file COPYING.  If not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA.
+ *
+ */
+
+
+#ifndef KTIMER_H
+#define KTIMER_H
+
+#include "board.h"
+#include "kclock.h"
+
+
+/**
+ * Delayed events: a hierarchical timing wheel.
+ *
+ * The time of the wheel is counted in jiffies, a jiffy being 2^KTIMER_JIFFY_SHIFT
+ * cycles of the clocksource (about 1.3ms at 100MHz).
+ * The wheel has KTIMER_NB_LEVELS levels of KTIMER_NB_SLOTS slots each: a slot of the
+ * level l covers 64^l jiffies, so that the wheel covers 64^4 jiffies (about 6 hours).
+ * Timers further away are kept in the last slot of the last level and re-queued
+ * each time that slot is reached.
+ *
+ * Adding and canceling a timer is O(1): it is linked in (or unlinked from) the
+ * doubly linked list of its slot. Each time the level 0 wraps, the next slot of the
+ * level 1 is cascaded down to the level 0 (and so on for the upper levels),
+ * so that each timer is moved at most KTIMER_NB_LEVELS-1 times: the expiry is
+ * amortized O(1). An occupancy bitmap per level allows to skip empty slots,
+ * and to find the next deadline without scanning the slots.
+ *
+ * The expired timers are upcalled from the timer bottom half, with the interrupts
+ * enabled: the callbacks are bottom-half events.
+ *
+ * Each timer may have a slack: its expiry may be delayed by up to that many jiffies.
+ * The expiry is then rounded, within the slack window, to the jiffy with the most
+ * trailing zero bits, so that timers with overlapping windows expire together:
+ * they cost a single wakeup, counted as saved wakeups.
+ *
+ * The wheel is fed either by a periodic tick, every jiffy, or in tickless mode
+ * (CONFIG_TICKLESS) by a one-shot programmed before going idle, for the next
+ * deadline of the wheel. With no pending timer, the hardware timer is stopped.
+ */
+#define KTIMER_JIFFY_SHIFT	17
+#define KTIMER_SLOT_BITS	6
+#define KTIMER_NB_SLOTS		(1 << KTIMER_SLOT_BITS)
+#define KTIMER_SLOT_MASK	(KTIMER_NB_SLOTS - 1)
+#define KTIMER_NB_LEVELS	4
+#define KTIMER_MAX_DELAY	((1ULL << (KTIMER_SLOT_BITS * KTIMER_NB_LEVELS)) - 1)
+
+#define KTIMER_NO_DEADLINE	((uint64_t)-1)
+
+
+struct ktimer;
+typedef void (*ktimer_func_t)(struct ktimer *timer, void *arg);
+
+struct ktimer
+{
+	struct ktimer		*next;
+	struct ktimer		*prev;
+	uint64_t		expires;	// Jiffy at which the timer expires, within its slack
+	uint64_t		requested;	// Jiffy at which the timer was requested to expire
+	uint32_t		slack;		// Jiffies the expiry may be delayed by
+	ktimer_func_t		func;
+	void			*arg;
+	uint8_t			level;		// Position in the wheel, when pending
+	uint8_t			slot;
+	uint8_t			pending;
+};
+
+struct ktimer_stats
+{
+	uint32_t		nbPending;
+	uint32_t		nbAdded;
+	uint32_t		nbCanceled;
+	uint32_t		nbExpired;
+	uint32_t		nbCascaded;
+	uint32_t		nbTicks;
+	uint32_t		nbSaved;	// Wakeups saved by the slack of the timers
+	uint32_t		nbIdles;	// Tickless idle: one-shot programmed
+	uint32_t		nbIdleStops;	// Tickless idle: timer stopped, no pending timer
+};
+
+
+/**
+ * Jiffies of the clocksource.
+ */
+ALWAYS_INLINE
+uint64_t jiffies()
+{
+	return cycles() >> KTIMER_JIFFY_SHIFT;
+}
+
+ALWAYS_INLINE
+uint64_t ktimer_ns_to_jiffies(uint64_t ns)
+{
+	uint64_t c = kclock_ns_to_cycles(ns);
+	return (c + (1 << KTIMER_JIFFY_SHIFT) - 1) >> KTIMER_JIFFY_SHIFT;
+}
+
+
+
+
+void		ktimer_init		();
+void		ktimer_setup		(struct ktimer *timer, ktimer_func_t func, void *arg);
+void		ktimer_set_slack	(struct ktimer *timer, uint64_t slack);
+void		ktimer_add		(struct ktimer *timer, uint64_t expires);
+void		ktimer_add_ns		(struct ktimer *timer, uint64_t delay);
+int		ktimer_cancel		(struct ktimer *timer);
+int		ktimer_irq		();
+void		ktimer_bottom		();
+uint64_t	ktimer_next_deadline	();
+void		ktimer_idle		();
+void		ktimer_busy		();
+void		ktimer_get_stats	(struct ktimer_stats *stats);
+
+
+
+#endif
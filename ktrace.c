@@ -0,0 +1,83 @@
+#include "ktrace.h"
+#include "pl011.h"
+#include "kclock.h"
+
+
+volatile uint8_t	ktraceEnabled;
+struct ktrace_ring	ktraceRings[KTRACE_NB_CPUS];
+
+
+
+
+/**
+ * Start tracing, from empty rings.
+ */
+void ktrace_start()
+{
+	uint32_t cpu;
+
+	ktraceEnabled = 0;
+	ksmp_dmb();
+	for (cpu=0; cpu<KTRACE_NB_CPUS; cpu++)
+		ktraceRings[cpu].head = 0;
+	ksmp_dmb();
+	ktraceEnabled = 1;
+}
+
+
+void ktrace_stop()
+{
+	ktraceEnabled = 0;
+	ksmp_dmb();
+}
+
+
+uint32_t ktrace_nb_records(uint32_t cpu)
+{
+	uint32_t head = ktraceRings[cpu].head;
+
+	return head < KTRACE_NB_RECORDS ? head : KTRACE_NB_RECORDS;
+}
+
+
+static void ktrace_write(const void *data, uint32_t length)
+{
+	const uint8_t *bytes = (const uint8_t*)data;
+
+	while (length--)
+		uart_send(KTRACE_STREAM_UART, *bytes++);
+}
+
+
+static void ktrace_write_word(uint32_t word)
+{
+	ktrace_write(&word, sizeof(word));
+}
+
+
+/**
+ * Stop tracing and write the rings, oldest record first, on the spare serial line,
+ * with polled writes, so that the stream does not depend on the interrupts.
+ */
+void ktrace_stream()
+{
+	struct ktrace_ring	*ring;
+	uint32_t		cpu, nbRecords, i;
+
+	ktrace_stop();
+	uart_init(KTRACE_STREAM_UART);
+	ktrace_write("KTRC", 4);
+	ktrace_write_word(KTRACE_VERSION);
+	ktrace_write_word(KTRACE_NB_CPUS);
+	ktrace_write_word(kclock.freq);
+	for (cpu=0; cpu<KTRACE_NB_CPUS; cpu++)
+	{
+		ring		= &ktraceRings[cpu];
+		nbRecords	= ktrace_nb_records(cpu);
+		ktrace_write_word(cpu);
+		ktrace_write_word(nbRecords);
+		for (i=ring->head-nbRecords; i!=ring->head; i++)
+			ktrace_write(&ring->records[i & KTRACE_RECORDS_MASK], sizeof(struct ktrace_record));
+	}
+	ktrace_write("KEND", 4);
+}
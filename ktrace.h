@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) SID LAKHDAR Riyane.
+ *
+ * This code is a patch to the code implemented by Pr Olivier 
+ * Gruber during the Advanced Operating System cours.
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Classpath; see the file COPYING.  If not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA.
+ *
+ */
+
+
+#ifndef KTRACE_H
+#define KTRACE_H
+
+#include "board.h"
+#include "gic.h"
+#include "gtimer.h"
+#include "ksmp.h"
+
+
+/**
+ * Event tracing (CONFIG_TRACE): a flight recorder of the interleaving of the IRQ tops,
+ * bottoms, timer callbacks, events and thread switches, for a timeline viewer.
+ *
+ * Each processor records in its own ring of compact binary records: the low word of
+ * the global timer, the kind of section, begin or end (or instant), and an argument
+ * (IRQ number, handler address, thread ids). The ring overwrites its oldest records,
+ * so that the last KTRACE_NB_RECORDS are kept. Recording is done with the interrupts
+ * disabled, a top half may interrupt a recording bottom half.
+ *
+ *	TRACE_BEGIN(KTRACE_BOTTOM, irq);
+ *	...
+ *	TRACE_END(KTRACE_BOTTOM, irq);
+ *
+ * The rings are streamed in binary on the spare serial line, tracing stopped,
+ * and converted on the host by tools/ktrace.py to the Chrome trace event JSON:
+ *	header:		"KTRC" version(u32) nbCpus(u32) timerHz(u32)
+ *	per processor:	cpu(u32) nbRecords(u32) records (struct ktrace_record)
+ *	trailer:	"KEND"
+ * All the words are little-endian. The global timer wraps its low word every 2^32
+ * ticks: the host unwraps the stamps, assuming records less than a wrap apart.
+ *
+ * Without CONFIG_TRACE, the macros expand to nothing, and ktrace.c (with its rings)
+ * is not built.
+ */
+#define KTRACE_NB_CPUS		KSMP_NB_CPUS
+#define KTRACE_NB_RECORDS	4096	// per CPU, must be a power of two
+#define KTRACE_RECORDS_MASK	(KTRACE_NB_RECORDS - 1)
+#define KTRACE_STREAM_UART	UART2
+#define KTRACE_VERSION		1
+
+#define KTRACE_IRQ_TOP		0	// arg: IRQ number
+#define KTRACE_BOTTOM		1	// arg: IRQ number
+#define KTRACE_TIMER		2	// arg: callback
+#define KTRACE_EVENT		3	// arg: reaction
+#define KTRACE_SWITCH		4	// arg: previous thread id << 16 | next thread id
+
+#define KTRACE_PHASE_BEGIN	0
+#define KTRACE_PHASE_END	1
+#define KTRACE_PHASE_INSTANT	2
+
+struct ktrace_record
+{
+	uint32_t		stamp;		// Low word of the global timer
+	uint32_t		arg;
+	uint8_t			kind;
+	uint8_t			phase;
+	uint16_t		reserved;
+};
+
+struct ktrace_ring
+{
+	uint32_t		head;		// Records ever written, the ring keeps the last ones
+	struct ktrace_record	records[KTRACE_NB_RECORDS];
+};
+
+#ifdef CONFIG_TRACE
+
+extern volatile uint8_t		ktraceEnabled;
+extern struct ktrace_ring	ktraceRings[KTRACE_NB_CPUS];
+
+
+
+
+void		ktrace_start		();
+void		ktrace_stop		();
+void		ktrace_stream		();
+uint32_t	ktrace_nb_records	(uint32_t cpu);
+
+
+ALWAYS_INLINE
+void ktrace_record(uint32_t kind, uint32_t phase, uint32_t arg)
+{
+	struct ktrace_ring	*ring;
+	struct ktrace_record	*record;
+	int			enabled;
+
+	if (!ktraceEnabled)
+		return;
+	enabled		= arm_disable_interrupts();
+	ring		= &ktraceRings[ksmp_cpu()];
+	record		= &ring->records[ring->head & KTRACE_RECORDS_MASK];
+	record->stamp	= gtimer_read_low();
+	record->arg	= arg;
+	record->kind	= kind;
+	record->phase	= phase;
+	ring->head++;
+	if (enabled)
+		arm_enable_interrupts();
+}
+
+
+#define TRACE_BEGIN(kind, arg)		ktrace_record((kind), KTRACE_PHASE_BEGIN, (uint32_t)(arg))
+#define TRACE_END(kind, arg)		ktrace_record((kind), KTRACE_PHASE_END, (uint32_t)(arg))
+#define TRACE_INSTANT(kind, arg)	ktrace_record((kind), KTRACE_PHASE_INSTANT, (uint32_t)(arg))
+
+#else
+
+#define TRACE_BEGIN(kind, arg)
+#define TRACE_END(kind, arg)
+#define TRACE_INSTANT(kind, arg)
+
+#endif
+
+
+
+#endif
@@ -0,0 +1,149 @@
+#include "kvfp.h"
+#include "kthread.h"
+#include "ksmp.h"
+
+
+/**
+ * Thread whose registers are in the FP unit, NULL if none.
+ */
+static struct kthread		*kvfpOwner;
+static struct kvfp_stats	kvfpStats;
+
+
+
+
+/**
+ * Grant the access to the coprocessors 10 and 11 (CPACR) of the current processor.
+ */
+static void kvfp_grant()
+{
+	uint32_t cpacr;
+
+	__asm__ __volatile__ ("mrc p15, 0, %0, c1, c0, 2" : "=r" (cpacr));
+	cpacr |= 0xF << 20;
+	__asm__ __volatile__ ("mcr p15, 0, %0, c1, c0, 2" : : "r" (cpacr));
+	__asm__ __volatile__ ("isb");
+}
+
+
+/**
+ * Grant the access to the unit, and keep it disabled.
+ */
+void kvfp_init()
+{
+	kvfp_grant();
+	kvfp_write_fpexc(0);
+	kvfpOwner = NULL;
+}
+
+
+/**
+ * Secondary processor: grant the access to the unit, and enable it.
+ */
+void kvfp_init_secondary()
+{
+	kvfp_grant();
+	kvfp_write_fpexc(1 << KVFP_BIT_FPEXC_EN);
+}
+
+
+/**
+ * Called on each thread switch: the unit is only enabled for its owner.
+ */
+void kvfp_switch(struct kthread *next)
+{
+	kvfp_write_fpexc(next == kvfpOwner ? 1 << KVFP_BIT_FPEXC_EN : 0);
+}
+
+
+/**
+ * The thread exits: its registers need not be saved anymore.
+ */
+void kvfp_release(struct kthread *thread)
+{
+	if (kvfpOwner == thread)
+		kvfpOwner = NULL;
+}
+
+
+static void kvfp_save(struct kvfp_state *state)
+{
+	uint64_t *d = state->d;
+
+	__asm__ __volatile__ (
+		".fpu neon\n"
+		"vstmia %0!, {d0-d15}\n"
+		"vstmia %0!, {d16-d31}\n"
+		"vmrs %1, fpscr\n"
+		: "+r" (d), "=r" (state->fpscr) : : "memory");
+}
+
+
+static void kvfp_restore(struct kvfp_state *state)
+{
+	uint64_t *d = state->d;
+
+	__asm__ __volatile__ (
+		".fpu neon\n"
+		"vldmia %0!, {d0-d15}\n"
+		"vldmia %0!, {d16-d31}\n"
+		"vmsr fpscr, %1\n"
+		: "+r" (d) : "r" (state->fpscr) : "memory");
+}
+
+
+/**
+ * Returns true if the instruction uses the FP unit: Advanced SIMD data processing,
+ * Advanced SIMD loads and stores, and coprocessor 10 and 11 instructions (VFP).
+ */
+static int kvfp_is_fp(uint32_t instr)
+{
+	if ((instr & 0xFE000000) == 0xF2000000)
+		return 1;
+	if ((instr & 0xFF100000) == 0xF4000000)
+		return 1;
+	if ((instr & 0x0C000E00) == 0x0C000A00)
+		return 1;
+	return 0;
+}
+
+
+/**
+ * Called by the undefined instruction handler (gic.s), with the interrupts disabled,
+ * for the instruction at pc. Returns true if the instruction is to be re-executed:
+ * it is an FP instruction and the unit has been given to the current thread.
+ */
+int kvfp_undef(uint32_t *pc)
+{
+	struct kthread *current;
+
+#ifdef CONFIG_SMP
+	if (ksmp_cpu() != 0)
+		return 0;
+#endif
+	current = kthread_self();
+	if (!kvfp_is_fp(*pc) || (kvfp_read_fpexc() & (1 << KVFP_BIT_FPEXC_EN)))
+		return 0;
+	if (current == NULL)
+		return 0;
+	kvfpStats.nbTraps++;
+	kvfp_write_fpexc(1 << KVFP_BIT_FPEXC_EN);
+	if (kvfpOwner != current)
+	{
+		if (kvfpOwner)
+		{
+			kvfp_save(&kvfpOwner->vfp);
+			kvfpStats.nbSaves++;
+		}
+		kvfp_restore(&current->vfp);
+		kvfpStats.nbRestores++;
+		kvfpOwner = current;
+	}
+	return 1;
+}
+
+
+void kvfp_get_stats(struct kvfp_stats *stats)
+{
+	*stats = kvfpStats;
+}
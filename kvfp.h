@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) SID LAKHDAR Riyane.
+ *
+ * This code is a patch to the code implemented by Pr Olivier 
+ * Gruber during the Advanced Operating System cours.
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Classpath; see the file COPYING.  If not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA.
+ *
+ */
+
+
+#ifndef KVFP_H
+#define KVFP_H
+
+#include "board.h"
+
+
+/**
+ * Lazy VFP/NEON context switch.
+ *
+ * The access to the VFP/NEON unit (coprocessors 10 and 11) is granted at boot, but
+ * the unit is kept disabled (FPEXC.EN cleared) except for the thread that owns its
+ * registers. On a switch, the unit is only re-enabled if the next thread is the owner.
+ * The first FP or NEON instruction of another thread traps as an undefined instruction:
+ * the trap saves the registers of the owner, restores the ones of the current thread,
+ * which becomes the owner, enables the unit and re-executes the instruction.
+ * The threads that never use the unit never pay for its 32 double registers.
+ *
+ * The kernel itself is compiled without the FP unit (soft-float ABI): only code that
+ * explicitly asks for it uses the unit, from a thread.
+ *
+ * The lazy switch is only done on the boot processor, which runs the threads.
+ * The secondary processors (see ksmp.h) only run work events to completion: their
+ * unit is enabled once and for all, with no register to save between events.
+ */
+#define KVFP_NB_DREGS		32
+
+#define KVFP_BIT_FPEXC_EN	30
+
+struct kvfp_state
+{
+	uint64_t		d[KVFP_NB_DREGS];
+	uint32_t		fpscr;
+};
+
+struct kvfp_stats
+{
+	uint32_t		nbTraps;	// FP instructions trapped with the unit disabled
+	uint32_t		nbSaves;	// Registers saved for the previous owner
+	uint32_t		nbRestores;	// Registers restored for the new owner
+};
+
+struct kthread;
+
+
+
+
+void		kvfp_init		();
+void		kvfp_init_secondary	();
+void		kvfp_switch		(struct kthread *next);
+void		kvfp_release		(struct kthread *thread);
+int		kvfp_undef		(uint32_t *pc);
+void		kvfp_get_stats		(struct kvfp_stats *stats);
+
+
+/**
+ * FPEXC, through its coprocessor 10 encoding, so that the kernel does not need
+ * to be assembled with the FP unit.
+ */
+ALWAYS_INLINE
+uint32_t kvfp_read_fpexc()
+{
+	uint32_t value;
+	__asm__ __volatile__ ("mrc p10, 7, %0, c8, c0, 0" : "=r" (value));
+	return value;
+}
+
+
+ALWAYS_INLINE
+void kvfp_write_fpexc(uint32_t value)
+{
+	__asm__ __volatile__ ("mcr p10, 7, %0, c8, c0, 0" : : "r" (value) : "memory");
+}
+
+
+
+#endif
@@ -22,7 +22,28 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include "board.h"
+#ifdef vexpress_a9
+#include "gic.h"
+#else
+#include "pl190.h"
+#endif
 #include "pl011.h"
+#include "kprobe.h"
+
+/*
+ * The UART ports of the board, see board.h.
+ */
+static struct uart_port uart_ports[] = {
+  { .uart = UART0, .no = 0, .irq = UART0_IRQ },
+  { .uart = UART1, .no = 1, .irq = UART1_IRQ },
+  { .uart = UART2, .no = 2, .irq = UART2_IRQ },
+#ifdef vexpress_a9
+  { .uart = UART3, .no = 3, .irq = UART3_IRQ },
+#endif
+};
+
+#define UART_NPORTS (sizeof(uart_ports)/sizeof(struct uart_port))
 
 /**
  * The PL011 is a UART controller.
@@ -147,6 +168,285 @@ void uart_ack_irqs(struct pl011_uart* uart) {
 }
 
 
+uint32_t uart_nports(void) {
+  return UART_NPORTS;
+}
+
+struct uart_port* uart_get_port(uint32_t no) {
+  if (no >= UART_NPORTS)
+    return NULL;
+  return &uart_ports[no];
+}
+
+struct uart_port* uart_port_of_irq(uint32_t irq) {
+  uint32_t no;
+  for (no = 0; no < UART_NPORTS; no++)
+    if (uart_ports[no].irq == irq)
+      return &uart_ports[no];
+  return NULL;
+}
+
+/*
+ * Open the given port: reset its software state and program the UART
+ * with the FIFOs and the receive interrupts (RX and RX timeout) enabled.
+ * The RX timeout interrupt is necessary to get the characters that remain
+ * in the RX FIFO below the RX trigger level.
+ * The error interrupts are also enabled, so that an overrun of the RX FIFO
+ * is accounted for when it happens, rather than silently losing bytes.
+ * The TX interrupt is only enabled when there are bytes waiting in the TX ring.
+ */
+void uart_port_open(struct uart_port* port, uint32_t ifls) {
+  struct pl011_uart* uart = port->uart;
+  uint32_t* stats = (uint32_t*)&port->stats;
+  uint32_t i;
+
+  port->rx.head = port->rx.tail = 0;
+  port->tx.head = port->tx.tail = 0;
+  for (i = 0; i < sizeof(struct uart_stats)/sizeof(uint32_t); i++)
+    stats[i] = 0;
+  port->bottom_pending = 0;
+  port->opened = 1;
+  port->xchar = 0;
+  port->rx_throttled = 0;
+  port->tx_stopped = 0;
+  port->flow = UART_FLOW_NONE;
+  port->ifls = ifls;
+  port->imsc = UART_IMSC_RXIM | UART_IMSC_RTIM |
+    UART_IMSC_OEIM | UART_IMSC_BEIM | UART_IMSC_PEIM | UART_IMSC_FEIM;
+
+  uart->CR &= ~(UART_CR_UARTEN | UART_CR_TXE | UART_CR_RXE);
+  uart->ICR = 0x7FFF;
+  uart->LCR_H |= UART_LCRH_FEN;
+  uart->IFLS = port->ifls;
+  uart->IMSC = port->imsc;
+  uart->CR |= (UART_CR_UARTEN | UART_CR_TXE | UART_CR_RXE);
+}
+
+void uart_port_bind(struct uart_port* port, uart_consumer_t consumer, void* arg) {
+  port->arg = arg;
+  port->consumer = consumer;
+}
+
+/*
+ * Move bytes from the TX ring to the TX FIFO, until the FIFO is full
+ * or the ring is empty. A pending XON/XOFF goes out first, even when
+ * the transmission is stopped by the peer. The TX interrupt is left
+ * enabled only if there remains something to send. Must be called
+ * with interrupts disabled, since the top half also empties the TX ring.
+ */
+static void uart_port_tx_fill(struct uart_port* port) {
+  struct pl011_uart* uart = port->uart;
+  struct uart_ring* tx = &port->tx;
+  uint32_t imsc;
+
+  if (port->xchar && !(uart->FR & UART_TXFF)) {
+    uart->DR = port->xchar;
+    port->xchar = 0;
+  }
+  while (!port->tx_stopped && tx->tail != tx->head && !(uart->FR & UART_TXFF)) {
+    uart->DR = tx->data[tx->tail & UART_RING_MASK];
+    tx->tail++;
+    port->stats.bytes_out++;
+  }
+  if (port->xchar || (!port->tx_stopped && tx->tail != tx->head))
+    imsc = port->imsc | UART_IMSC_TXIM;
+  else
+    imsc = port->imsc & ~UART_IMSC_TXIM;
+  if (imsc != port->imsc) {
+    port->imsc = imsc;
+    uart->IMSC = imsc;
+  }
+}
+
+/*
+ * Move all the bytes from the RX FIFO to the RX ring,
+ * accounting for the errors flagged along with each byte.
+ * Bytes received with a framing error or as a break are not data,
+ * they are discarded. Overruns are accounted for by their interrupt.
+ * With the XON/XOFF flow control, the XON/XOFF bytes are consumed here
+ * and XOFF is sent when the ring reaches its high watermark.
+ * Returns the number of bytes queued.
+ */
+static uint32_t uart_port_rx_drain(struct uart_port* port) {
+  struct pl011_uart* uart = port->uart;
+  struct uart_ring* rx = &port->rx;
+  uint32_t nbytes = 0;
+
+  while (!(uart->FR & UART_RXFE)) {
+    uint32_t dr = uart->DR;
+    if (dr & (UART_DR_OE | UART_DR_BE | UART_DR_PE | UART_DR_FE)) {
+      if (dr & UART_DR_PE)
+        port->stats.parity++;
+      if (dr & UART_DR_BE)
+        port->stats.breaks++;
+      if (dr & UART_DR_FE)
+        port->stats.framing++;
+      uart->RSR_ECR = 0;
+      if (dr & (UART_DR_BE | UART_DR_FE))
+        continue;
+    }
+    if (port->flow == UART_FLOW_XONXOFF) {
+      if ((uint8_t)dr == UART_XOFF) {
+        port->tx_stopped = 1;
+        continue;
+      }
+      if ((uint8_t)dr == UART_XON) {
+        port->tx_stopped = 0;
+        continue;
+      }
+    }
+    if (uart_ring_count(rx) >= UART_RING_SIZE) {
+      port->stats.dropped++;
+      continue;
+    }
+    rx->data[rx->head & UART_RING_MASK] = (uint8_t)dr;
+    rx->head++;
+    nbytes++;
+  }
+  port->stats.bytes_in += nbytes;
+  if (port->flow == UART_FLOW_XONXOFF && !port->rx_throttled &&
+      uart_ring_count(rx) >= UART_RX_HIGH_WATERMARK) {
+    port->rx_throttled = 1;
+    port->xchar = UART_XOFF;
+    port->stats.xoffs++;
+  }
+  return nbytes;
+}
+
+/*
+ * Top half of the port, called with interrupts disabled.
+ * Empties the RX FIFO and refills the TX FIFO, so one interrupt
+ * handles as many bytes as possible. The bottom half is requested
+ * only once, until it runs.
+ */
+int uart_port_irq(struct uart_port* port) {
+  struct pl011_uart* uart = port->uart;
+  uint32_t mis = uart->MIS;
+  uint32_t nbytes;
+  PROBE_BEGIN(uart_port_irq);
+
+  port->stats.irqs++;
+  if (mis & UART_IMSC_OEIM)
+    port->stats.overruns++;
+  nbytes = uart_port_rx_drain(port);
+  /*
+   * The transmission may also have to resume, or an XON/XOFF go out,
+   * after draining the RX FIFO.
+   */
+  uart_port_tx_fill(port);
+  uart->ICR = mis & ~(UART_IMSC_RXIM | UART_IMSC_TXIM);
+  PROBE_END(uart_port_irq);
+
+  if (nbytes == 0 || port->bottom_pending)
+    return 0;
+  port->bottom_pending = 1;
+  return 1;
+}
+
+void uart_port_bottom(struct uart_port* port) {
+  PROBE_BEGIN(uart_port_bottom);
+  port->bottom_pending = 0;
+  if (port->consumer)
+    port->consumer(port, port->arg);
+  PROBE_END(uart_port_bottom);
+}
+
+/*
+ * With the XON/XOFF flow control, XON is sent once the ring is back
+ * to its low watermark, the peer has been throttled by the top half.
+ */
+int uart_port_getc(struct uart_port* port, unsigned char* c) {
+  struct uart_ring* rx = &port->rx;
+  int enabled;
+
+  if (rx->tail == rx->head)
+    return 0;
+  *c = rx->data[rx->tail & UART_RING_MASK];
+  rx->tail++;
+  if (port->rx_throttled && uart_ring_count(rx) <= UART_RX_LOW_WATERMARK) {
+    enabled = arm_disable_interrupts();
+    if (port->rx_throttled) {
+      port->rx_throttled = 0;
+      port->xchar = UART_XON;
+      port->stats.xons++;
+      uart_port_tx_fill(port);
+    }
+    if (enabled)
+      arm_enable_interrupts();
+  }
+  return 1;
+}
+
+/*
+ * Turning the flow control off restarts a transmission stopped by the peer
+ * and lets the peer send again, if it was throttled.
+ */
+void uart_port_flow(struct uart_port* port, uint32_t flow) {
+  int enabled = arm_disable_interrupts();
+  port->flow = flow;
+  if (flow == UART_FLOW_NONE) {
+    port->tx_stopped = 0;
+    if (port->rx_throttled) {
+      port->rx_throttled = 0;
+      port->xchar = UART_XON;
+      port->stats.xons++;
+    }
+    uart_port_tx_fill(port);
+  }
+  if (enabled)
+    arm_enable_interrupts();
+}
+
+/*
+ * Queue the given bytes in the TX ring, and start the transmission.
+ * The ring has several producers (the main loop, the kernel threads and
+ * the interrupt top halves, through kprintf), so the slots are reserved
+ * and filled with the interrupts disabled. If the ring is full, wait for
+ * the TX FIFO to make some room, unless the transmission is stopped by
+ * the peer (XOFF): the XON may never come, for instance with the interrupts
+ * disabled, so the bytes that do not fit in the ring are not queued.
+ * Returns the number of bytes queued.
+ */
+uint32_t uart_port_write(struct uart_port* port, const unsigned char* s, uint32_t len) {
+  struct uart_ring* tx = &port->tx;
+  uint32_t queued = 0;
+  int enabled;
+  PROBE_BEGIN(uart_port_write);
+
+  while (len) {
+    enabled = arm_disable_interrupts();
+    while (len && uart_ring_count(tx) < UART_RING_SIZE) {
+      tx->data[tx->head & UART_RING_MASK] = *s++;
+      tx->head++;
+      len--;
+      queued++;
+    }
+    uart_port_tx_fill(port);
+    if (len && port->tx_stopped) {
+      port->stats.tx_dropped += len;
+      len = 0;
+    }
+    if (enabled)
+      arm_enable_interrupts();
+    if (len)
+      while (port->uart->FR & UART_TXFF);
+  }
+  PROBE_END(uart_port_write);
+  return queued;
+}
+
+uint32_t uart_port_putc(struct uart_port* port, unsigned char c) {
+  return uart_port_write(port, &c, 1);
+}
+
+uint32_t uart_port_puts(struct uart_port* port, const unsigned char* s) {
+  const unsigned char* e = s;
+  while (*e != '\0')
+    e++;
+  return uart_port_write(port, s, e - s);
+}
+
+
 /*
  * Local Variables:
  * mode: c
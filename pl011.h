@@ -139,6 +139,8 @@ struct __attribute__ ((__packed__)) pl011_uart {
  *          When the UART is disabled in the middle of transmission or reception, it completes
  *          the current character before stopping.
  */
+#define UART_LCRH_FEN  (1<<4)  /* Line control register: enable FIFOs */
+
 #define UART_CR_UARTEN (1<<0)
 #define UART_CR_TXE    (1<<8)
 #define UART_CR_RXE    (1<<9)
@@ -219,6 +221,114 @@ struct __attribute__ ((__packed__)) pl011_uart {
 #define UART_ICR_CTSMIC (1<<1)
 #define UART_ICR_RIMIC (1<<0)
 
+/**
+ * Data register error bits, read along with each received character.
+ * 11 OE  Overrun error, the character was received while the receive FIFO was full.
+ * 10 BE  Break error, a break condition was detected.
+ *  9 PE  Parity error.
+ *  8 FE  Framing error, the character did not have a valid stop bit.
+ */
+#define UART_DR_FE (1<<8)
+#define UART_DR_PE (1<<9)
+#define UART_DR_BE (1<<10)
+#define UART_DR_OE (1<<11)
+
+/**
+ * Interrupt FIFO Level Select register
+ * 5:3  RXIFLSEL  Receive interrupt FIFO level select.
+ * 2:0  TXIFLSEL  Transmit interrupt FIFO level select.
+ * The trigger points are, for both: 1/8, 1/4, 1/2, 3/4, and 7/8 full.
+ * The RX interrupt is raised when the RX FIFO becomes greater than or equal
+ * to its trigger level, the TX interrupt is raised when the TX FIFO becomes
+ * less than or equal to its trigger level.
+ */
+#define UART_IFLS_1_8 0x0
+#define UART_IFLS_1_4 0x1
+#define UART_IFLS_1_2 0x2
+#define UART_IFLS_3_4 0x3
+#define UART_IFLS_7_8 0x4
+#define UART_IFLS(rx,tx) ((((rx) & 0x7) << 3) | ((tx) & 0x7))
+
+/**
+ * Software state of an UART port, on top of the pl011_uart registers.
+ *
+ * Each port has a receive ring and a transmit ring, filled and emptied
+ * by the interrupt handler (top half) on one side and by the consumer
+ * of the port (bottom half) on the other side. The RX ring has one
+ * producer and one consumer, so it needs no locking. The TX ring has
+ * several producers (kprintf writes to the UART0 port from the threads
+ * and the top halves), they reserve its slots with the interrupts
+ * disabled, as does the top half that empties it.
+ *
+ * A port is bound to a consumer at runtime, the consumer is upcalled
+ * from the bottom half each time the top half received characters.
+ */
+#define UART_RING_SIZE 256 /* must be a power of two */
+#define UART_RING_MASK (UART_RING_SIZE-1)
+
+struct uart_ring {
+  volatile uint32_t head;  /* next byte to write, written by the producers */
+  volatile uint32_t tail;  /* next byte to read, written by the consumer */
+  uint8_t data[UART_RING_SIZE];
+};
+
+struct uart_stats {
+  uint32_t bytes_in;   /* bytes received and queued in the RX ring */
+  uint32_t bytes_out;  /* bytes written to the TX FIFO */
+  uint32_t dropped;    /* bytes received while the RX ring was full */
+  uint32_t overruns;   /* RX FIFO overruns (overrun error interrupts) */
+  uint32_t framing;    /* framing errors */
+  uint32_t parity;     /* parity errors */
+  uint32_t breaks;     /* break conditions */
+  uint32_t irqs;       /* interrupts handled by the top half */
+  uint32_t xoffs;      /* XOFF sent, the RX ring reached its high watermark */
+  uint32_t xons;       /* XON sent, the RX ring went back to its low watermark */
+  uint32_t tx_dropped; /* bytes not queued, the TX ring full while stopped by XOFF */
+};
+
+/**
+ * Software flow control (XON/XOFF).
+ * When on, the port sends XOFF to its peer when the RX ring fills up
+ * to its high watermark and XON when the ring drains down to its low
+ * watermark. The XON/XOFF received from the peer are not queued in the
+ * RX ring, they stop and restart the transmission of the port.
+ */
+#define UART_FLOW_NONE    0
+#define UART_FLOW_XONXOFF 1
+
+#define UART_XON  0x11
+#define UART_XOFF 0x13
+
+#define UART_RX_HIGH_WATERMARK ((UART_RING_SIZE*3)/4)
+#define UART_RX_LOW_WATERMARK  (UART_RING_SIZE/4)
+
+struct uart_port;
+typedef void (*uart_consumer_t)(struct uart_port* port, void* arg);
+
+struct uart_port {
+  struct pl011_uart* uart;
+  uint32_t no;
+  uint32_t irq;
+  uint32_t ifls;
+  uint32_t imsc;
+  uint32_t flow;
+  uart_consumer_t consumer;
+  void* arg;
+  volatile uint8_t bottom_pending;
+  uint8_t opened;               /* Opened, see uart_port_open */
+  volatile uint8_t xchar;       /* XON or XOFF to send before the TX ring, 0 if none */
+  volatile uint8_t rx_throttled; /* XOFF sent, XON not sent yet */
+  volatile uint8_t tx_stopped;   /* XOFF received, XON not received yet */
+  struct uart_ring rx;
+  struct uart_ring tx;
+  struct uart_stats stats;
+};
+
+ALWAYS_INLINE uint32_t
+uart_ring_count(struct uart_ring* ring) {
+  return ring->head - ring->tail;
+}
+
 extern void uart_init(struct pl011_uart* uart);
 
 
@@ -248,4 +358,52 @@ extern void uart_clear_all_irqs(struct pl011_uart* uart);
 
 extern void uart_ack_irqs(struct pl011_uart* uart);
 
+/**
+ * Number of UART ports on the board, and access to the port objects.
+ */
+extern uint32_t uart_nports(void);
+extern struct uart_port* uart_get_port(uint32_t no);
+extern struct uart_port* uart_port_of_irq(uint32_t irq);
+
+/**
+ * Initialize the given port, with interrupts on, and the given FIFO trigger levels
+ * (see UART_IFLS). The port interrupt must still be enabled at the interrupt controller.
+ */
+extern void uart_port_open(struct uart_port* port, uint32_t ifls);
+
+/**
+ * Set the flow control of the given port, see UART_FLOW_NONE and UART_FLOW_XONXOFF.
+ */
+extern void uart_port_flow(struct uart_port* port, uint32_t flow);
+
+/**
+ * Bind the port to a consumer, upcalled from the bottom half
+ * when characters have been received.
+ */
+extern void uart_port_bind(struct uart_port* port, uart_consumer_t consumer, void* arg);
+
+/**
+ * Top half, called from the interrupt handler for the port IRQ.
+ * Returns true if the bottom half must be scheduled.
+ */
+extern int uart_port_irq(struct uart_port* port);
+
+/**
+ * Bottom half, upcalls the consumer bound to the port.
+ */
+extern void uart_port_bottom(struct uart_port* port);
+
+/**
+ * Get a received byte, returns 0 if there is none.
+ */
+extern int uart_port_getc(struct uart_port* port, unsigned char* c);
+
+/**
+ * Queue a byte to send, or a buffer of bytes to send. Return the number of bytes
+ * queued, short only if the transmission is stopped by the peer and the ring is full.
+ */
+extern uint32_t uart_port_putc(struct uart_port* port, unsigned char c);
+extern uint32_t uart_port_write(struct uart_port* port, const unsigned char* s, uint32_t len);
+extern uint32_t uart_port_puts(struct uart_port* port, const unsigned char* s);
+
 #endif /* PL011_H_ */
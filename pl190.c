@@ -40,10 +40,21 @@ void vic_init(void) {
 }
 
 
+/*
+ * Each enabled IRQ takes the next vectored interrupt slot,
+ * the first enabled having the highest priority.
+ * There are only PL190_NVECTORS slots.
+ */
+static uint32_t vic_nvectors;
+
 void vic_enable_irq(uint32_t irqno, uint32_t isr) {
 
-  vic_vectaddrs->isrs[0] = isr;
-  vic_vectcntls->srcs[0] = (1<<5) | irqno;
+  if (vic_nvectors >= PL190_NVECTORS || irqno >= 32)
+    panic(-1, "VIC: no vectored slot for irq %d\n", irqno);
+
+  vic_vectaddrs->isrs[vic_nvectors] = isr;
+  vic_vectcntls->srcs[vic_nvectors] = (1<<5) | irqno;
+  vic_nvectors++;
   vic->intr_select &= ~(1<<irqno);
   vic->intr_enable = 1<<irqno;
 }
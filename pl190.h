@@ -30,6 +30,7 @@
 #define CPSR_ABT_MODE 0x17
 #define CPSR_UND_MODE 0x1B
 #define CPSR_SYS_MODE 0x1F
+#define CPSR_MODE_MASK 0x1F
 
 #define CPSR_IRQ_FLAG   0x80      /* when set, IRQs are disabled, at the core level */
 #define CPSR_FIQ_FLAG   0x40      /* when set, FIQs are disabled, at the core level */
@@ -38,6 +39,18 @@
 typedef uint32_t irq_id_t;
 typedef uint32_t cpu_id_t;
 
+/*
+ * The state of the interrupted code, as saved by _arm_irq_handler (pl190.s)
+ * on the SYS mode stack, and given to irq_handler:
+ * the caller-save registers, the SYS mode LR, and the return state (PC and CPSR).
+ */
+struct irq_frame {
+  uint32_t r0, r1, r2, r3, r12;
+  uint32_t lr;
+  uint32_t pc;
+  uint32_t cpsr;
+};
+
 /*
  * Enables IRQs, FIQs unchanged.
  *    No MODE change... probably in SYS_MODE.
@@ -79,6 +92,16 @@ int arm_disable_interrupts(void) {
   return (old & 0x80) == 0;
 }
 
+/*
+ * Returns the current processor mode (CPSR_*_MODE).
+ */
+ALWAYS_INLINE
+uint32_t arm_mode(void) {
+  uint32_t cpsr;
+  __asm__ __volatile__("mrs %0, cpsr" : "=r" (cpsr));
+  return cpsr & CPSR_MODE_MASK;
+}
+
 #define PL190_BAR0 0x10140000
 #define PL190_BAR1 0x10140100 // VectAddr
 #define PL190_BAR2 0x10140200 // VectCntls 0x200-0c23c
@@ -241,8 +264,10 @@ struct __attribute__ ((__packed__)) pl190 {
  * The read/write VICVECTADDR[0-15] Registers span address locations 0x100-0x13C
  * from PL190_BAR0 (0x10140000). They contain the ISR vector addresses.
  */
+#define PL190_NVECTORS 16
+
 struct __attribute__ ((__packed__)) pl190_vectaddr {
-  volatile uint32_t isrs[16];
+  volatile uint32_t isrs[PL190_NVECTORS];
 };
 
 /*
@@ -253,7 +278,7 @@ struct __attribute__ ((__packed__)) pl190_vectaddr {
  * [4:0]    Selects interrupt source. You can select any of the 32 interrupt sources
  */
 struct __attribute__ ((__packed__)) pl190_vectcntls {
-  volatile uint32_t srcs[16];
+  volatile uint32_t srcs[PL190_NVECTORS];
 };
 
 /*
@@ -263,6 +263,7 @@ _arm_irq_handler:
 
     MSR     cpsr_c,#((CPSR_SYS_MODE | CPSR_IRQ_FLAG | CPSR_FIQ_FLAG)) /* SYS mode, no IRQ/FIQ */
 
+    MOV     r0,sp               /* the saved context is the irq_frame argument */
     LDR     r12,=irq_handler
     MOV     lr,pc               /* copy the return address to link register */
     BX      r12                 /* call the C IRQ-handler (ARM/THUMB) */
@@ -0,0 +1,56 @@
+#include "sp804.h"
+
+
+
+
+/**
+ * Stop both channels of the dual timer and clear their interrupts.
+ */
+void sp804_init(void *base)
+{
+	uint32_t channel;
+
+	for (channel=0; channel<SP804_NB_CHANNELS; channel++)
+	{
+		arm_mmio_write32(SP804_CHANNEL(base, channel), SP804_OFF_REGISTER_CONTROL, 0);
+		arm_mmio_write32(SP804_CHANNEL(base, channel), SP804_OFF_REGISTER_INTCLR, 1);
+	}
+}
+
+
+/**
+ * Fire every given number of ticks.
+ * The channel is stopped while its counter is loaded.
+ */
+void sp804_arm_periodic(uintptr_t channel, uint32_t ticks)
+{
+	uint32_t control = 0;
+
+	control = setBit32(control, SP804_BIT_REGISTER_CONTROL_SIZE_32);
+	control = setBit32(control, SP804_BIT_REGISTER_CONTROL_PERIODIC);
+	control = setBit32(control, SP804_BIT_REGISTER_CONTROL_INTERUPT_ENABLE);
+	arm_mmio_write32(channel, SP804_OFF_REGISTER_CONTROL, 0);
+	arm_mmio_write32(channel, SP804_OFF_REGISTER_LOAD, ticks);
+	control = setBit32(control, SP804_BIT_REGISTER_CONTROL_ENABLE);
+	arm_mmio_write32(channel, SP804_OFF_REGISTER_CONTROL, control);
+}
+
+
+void sp804_disarm(uintptr_t channel)
+{
+	arm_mmio_write32(channel, SP804_OFF_REGISTER_CONTROL, 0);
+	arm_mmio_write32(channel, SP804_OFF_REGISTER_INTCLR, 1);
+}
+
+
+/**
+ * Clear the interrupt of the channel.
+ * Both channels share the interrupt line: returns true if this channel was interrupting.
+ */
+int sp804_ack(uintptr_t channel)
+{
+	if (arm_mmio_read32(channel, SP804_OFF_REGISTER_MIS) == 0)
+		return 0;
+	arm_mmio_write32(channel, SP804_OFF_REGISTER_INTCLR, 1);
+	return 1;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) SID LAKHDAR Riyane.
+ *
+ * This code is a patch to the code implemented by Pr Olivier 
+ * Gruber during the Advanced Operating System cours.
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Classpath; see the file COPYING.  If not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301 USA.
+ *
+ */
+
+
+#ifndef SP804_H
+#define SP804_H
+
+#include "board.h"
+
+
+
+/**
+ * ARM SP804 dual timer, on the motherboard of both boards (two of them, four channels).
+ * Unlike the Cortex-A9 private timer, it is a plain bus device, shared by the processors,
+ * with one interrupt per dual timer (both channels), clocked by a 1MHz reference clock.
+ *
+ * Each channel is a decrementing counter, only driven in periodic mode here
+ * (it reloads from the load register when it reaches zero), for the sampling
+ * profiler on both boards. The channel raises its interrupt each time it reaches zero.
+ * The timing wheel and the clocksource stay on the Cortex-A9 timers (VExpress-A9 only).
+ */
+#define SP804_CLK_HZ				1000000
+
+#define SP804_NB_CHANNELS			2
+#define SP804_CHANNEL_SIZE			0x20
+#define SP804_CHANNEL(base, channel)		((uintptr_t)(base) + (channel) * SP804_CHANNEL_SIZE)
+
+/**
+ * Offset of the registers of a channel (relative to the channel base)
+ */
+#define SP804_OFF_REGISTER_LOAD			0x00
+#define SP804_OFF_REGISTER_VALUE		0x04
+#define SP804_OFF_REGISTER_CONTROL		0x08
+#define SP804_OFF_REGISTER_INTCLR		0x0C
+#define SP804_OFF_REGISTER_RIS			0x10
+#define SP804_OFF_REGISTER_MIS			0x14
+#define SP804_OFF_REGISTER_BGLOAD		0x18
+
+/**
+ * Index in the control register of a channel where to find the given informations
+ */
+#define SP804_BIT_REGISTER_CONTROL_ENABLE	7
+#define SP804_BIT_REGISTER_CONTROL_PERIODIC	6
+#define SP804_BIT_REGISTER_CONTROL_INTERUPT_ENABLE	5
+#define SP804_BIT_REGISTER_CONTROL_PRESCALER	2	// 2 bits: divide by 1, 16 or 256
+#define SP804_BIT_REGISTER_CONTROL_SIZE_32	1
+#define SP804_BIT_REGISTER_CONTROL_ONESHOT	0
+
+
+
+
+void		sp804_init		(void *base);
+void		sp804_arm_periodic	(uintptr_t channel, uint32_t ticks);
+void		sp804_disarm		(uintptr_t channel);
+int		sp804_ack		(uintptr_t channel);
+
+
+
+#endif
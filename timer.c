@@ -1,56 +1,177 @@
 #include "timer.h"
+#include "gic.h"
+#include "gid.h"
+
+
+/**
+ * Control register value last written: the control register is only
+ * written when the mode changes, reprogramming the timer in the same
+ * mode is a single store to the load register.
+ */
+static uint32_t	timerControl;
+
 
 
 
+ALWAYS_INLINE
+uintptr_t timer_base()
+{
+	return cortex_a9_peripheral_base() + ARM_PWT_BASE_OFFSET;
+}
+
+
+ALWAYS_INLINE
+void timer_set_control(uint32_t control)
+{
+	if (control != timerControl)
+	{
+		timerControl = control;
+		arm_mmio_write32(timer_base(), TIMER_OFF_REGISTER_CONTROL, control);
+	}
+}
+
 
 /**
- *
+ * Stop the timer, clear its event flag, set its prescaler,
+ * and enable its interrupt at the distributor.
  */
-void setTimmer(uint32_t time, char multipleShot)
+void timer_init(uint8_t prescaler)
 {
-cortex_a9_gid_enable_irq(29);
-cortex_a9_gid_enable_irq(30);
-uint32_t watchdogCtrlVal = arm_mmio_read32(cortex_a9_peripheral_base() + ARM_PWT_BASE_OFFSET, TIMER_OFF_WATCHDOG_REGISTER_CONTROL);
-	uint32_t watchdogCtrlValSave = watchdogCtrlVal;
-	uint32_t offset;
-   
-	char isWatchdogMode  = getBit32(watchdogCtrlVal, TIMER_BIT_WATCHDOG_REGISTER_CONTROL_WATCHDOG_MODE);
-	char isInterupEnable = getBit32(watchdogCtrlVal, TIMER_BIT_WATCHDOG_REGISTER_CONTROL_INTERUPT_ENABLE);
-	char isAutoReload    = getBit32(watchdogCtrlVal, TIMER_BIT_WATCHDOG_REGISTER_CONTROL_AUTO_RELOAD);
-	char isWatchdogEnable= getBit32(watchdogCtrlVal, TIMER_BIT_WATCHDOG_REGISTER_CONTROL_WATCHDOG_ENABLE);
+	timerControl = (uint32_t)prescaler << TIMER_BIT_REGISTER_CONTROL_PRESCALER;
+	arm_mmio_write32(timer_base(), TIMER_OFF_REGISTER_CONTROL, timerControl);
+	arm_mmio_write32(timer_base(), TIMER_OFF_REGISTER_INTERRUPT_STATUS, 1);
+	cortex_a9_gid_enable_irq(TIMER_PRIVATE_IRQ);
+}
 
-	// Case timer in Watchdog mode
-	if (isWatchdogMode)	offset = TIMER_OFF_WATCHDOG_REGISTER_LOAD;
-	// Case timer in timer mode (default)
-	else			offset = TIMER_OFF_WATCHDOG_REGISTER_COUNTER;
 
-	// Update the timer value
-arm_mmio_write32(cortex_a9_peripheral_base() + ARM_PWT_BASE_OFFSET, offset, time);
+/**
+ * Frequency of the timer (Hz), after the prescaler.
+ */
+uint32_t timer_freq()
+{
+	uint32_t prescaler = (timerControl & TIMER_MASK_REGISTER_CONTROL_PRESCALER) >> TIMER_BIT_REGISTER_CONTROL_PRESCALER;
 
-	if (!isInterupEnable)
-	     watchdogCtrlVal = setBit32(watchdogCtrlVal, TIMER_BIT_WATCHDOG_REGISTER_CONTROL_INTERUPT_ENABLE);
-	if (!isWatchdogEnable)
-	     watchdogCtrlVal = setBit32(watchdogCtrlVal, TIMER_BIT_WATCHDOG_REGISTER_CONTROL_WATCHDOG_ENABLE);
-	if (!isAutoReload && multipleShot)
-	{
-	     watchdogCtrlVal = setBit32(watchdogCtrlVal, TIMER_BIT_WATCHDOG_REGISTER_CONTROL_AUTO_RELOAD);
-	     if (! isWatchdogMode)
-	     {
-arm_mmio_write32(cortex_a9_peripheral_base() + ARM_PWT_BASE_OFFSET, TIMER_OFF_WATCHDOG_REGISTER_LOAD, time);
-	     }
-	}
+	return CORTEX_A9_PERIPHCLK_HZ / (prescaler + 1);
+}
+
+
+/**
+ * Fire once, after the given number of ticks.
+ */
+void timer_arm_oneshot(uint32_t ticks)
+{
+	uint32_t control = timerControl & TIMER_MASK_REGISTER_CONTROL_PRESCALER;
+
+	control = setBit32(control, TIMER_BIT_REGISTER_CONTROL_INTERUPT_ENABLE);
+	control = setBit32(control, TIMER_BIT_REGISTER_CONTROL_TIMER_ENABLE);
+	arm_mmio_write32(timer_base(), TIMER_OFF_REGISTER_LOAD, ticks);
+	timer_set_control(control);
+}
+
+
+/**
+ * Fire every given number of ticks.
+ */
+void timer_arm_periodic(uint32_t ticks)
+{
+	uint32_t control = timerControl & TIMER_MASK_REGISTER_CONTROL_PRESCALER;
+
+	control = setBit32(control, TIMER_BIT_REGISTER_CONTROL_INTERUPT_ENABLE);
+	control = setBit32(control, TIMER_BIT_REGISTER_CONTROL_AUTO_RELOAD);
+	control = setBit32(control, TIMER_BIT_REGISTER_CONTROL_TIMER_ENABLE);
+	arm_mmio_write32(timer_base(), TIMER_OFF_REGISTER_LOAD, ticks);
+	timer_set_control(control);
+}
+
+
+/**
+ * Restart the timer, in its current mode, for the given number of ticks.
+ * In one-shot mode, this re-arms the timer even if it has already fired.
+ */
+void timer_reprogram(uint32_t ticks)
+{
+	arm_mmio_write32(timer_base(), TIMER_OFF_REGISTER_LOAD, ticks);
+	timer_set_control(setBit32(timerControl, TIMER_BIT_REGISTER_CONTROL_TIMER_ENABLE));
+}
 
-	// Set the watchdog control value (if has changed)
-	if (watchdogCtrlVal != watchdogCtrlValSave)
-		arm_mmio_write32(ARM_PWT_BASE_OFFSET, TIMER_OFF_WATCHDOG_REGISTER_CONTROL, watchdogCtrlVal);
 
+/**
+ * Stop the timer, its event flag is cleared so that no interrupt remains pending.
+ */
+void timer_disarm()
+{
+	timer_set_control(timerControl & TIMER_MASK_REGISTER_CONTROL_PRESCALER);
+	arm_mmio_write32(timer_base(), TIMER_OFF_REGISTER_INTERRUPT_STATUS, 1);
 }
 
 
 /**
- *
+ * Clear the event flag of the timer, which also lowers its interrupt.
  */
-void unsetTimmer()
+void timer_ack()
+{
+	arm_mmio_write32(timer_base(), TIMER_OFF_REGISTER_INTERRUPT_STATUS, 1);
+}
+
+
+/**
+ * Read the current state of the timer registers.
+ */
+void timer_get_state(uint32_t *load, uint32_t *counter, uint32_t *control)
+{
+	uintptr_t base = timer_base();
+
+	*load		= arm_mmio_read32(base, TIMER_OFF_REGISTER_LOAD);
+	*counter	= arm_mmio_read32(base, TIMER_OFF_REGISTER_COUNTER);
+	*control	= arm_mmio_read32(base, TIMER_OFF_REGISTER_CONTROL);
+}
+
+
+
+/**
+ * Use the watchdog, in timer mode, as a periodic timer (no prescaler).
+ * Its interrupt is enabled at the distributor.
+ */
+void timer_watchdog_arm_periodic(uint32_t ticks)
+{
+	uintptr_t	base	= timer_base();
+	uint32_t	control	= 0;
+
+	control = setBit32(control, TIMER_BIT_WATCHDOG_REGISTER_CONTROL_INTERUPT_ENABLE);
+	control = setBit32(control, TIMER_BIT_WATCHDOG_REGISTER_CONTROL_AUTO_RELOAD);
+	control = setBit32(control, TIMER_BIT_WATCHDOG_REGISTER_CONTROL_WATCHDOG_ENABLE);
+	arm_mmio_write32(base, TIMER_OFF_WATCHDOG_REGISTER_CONTROL, 0);
+	arm_mmio_write32(base, TIMER_OFF_WATCHDOG_REGISTER_INTERRUPT_STATUS, 1);
+	arm_mmio_write32(base, TIMER_OFF_WATCHDOG_REGISTER_LOAD, ticks);
+	arm_mmio_write32(base, TIMER_OFF_WATCHDOG_REGISTER_CONTROL, control);
+	cortex_a9_gid_enable_irq(TIMER_WATCHDOG_IRQ);
+}
+
+
+/**
+ * Use the watchdog, in timer mode, as a one-shot timer (no prescaler).
+ * Its interrupt must have been enabled at the distributor.
+ */
+void timer_watchdog_arm_oneshot(uint32_t ticks)
+{
+	uintptr_t	base	= timer_base();
+	uint32_t	control	= 0;
+
+	control = setBit32(control, TIMER_BIT_WATCHDOG_REGISTER_CONTROL_INTERUPT_ENABLE);
+	control = setBit32(control, TIMER_BIT_WATCHDOG_REGISTER_CONTROL_WATCHDOG_ENABLE);
+	arm_mmio_write32(base, TIMER_OFF_WATCHDOG_REGISTER_LOAD, ticks);
+	arm_mmio_write32(base, TIMER_OFF_WATCHDOG_REGISTER_CONTROL, control);
+}
+
+
+void timer_watchdog_disarm()
+{
+	arm_mmio_write32(timer_base(), TIMER_OFF_WATCHDOG_REGISTER_CONTROL, 0);
+	arm_mmio_write32(timer_base(), TIMER_OFF_WATCHDOG_REGISTER_INTERRUPT_STATUS, 1);
+}
+
+
+void timer_watchdog_ack()
 {
-// TODO
+	arm_mmio_write32(timer_base(), TIMER_OFF_WATCHDOG_REGISTER_INTERRUPT_STATUS, 1);
 }
@@ -20,6 +20,7 @@
  *
  */
 
+
 #ifndef TIMER_H
 #define TIMER_H
 
@@ -27,6 +28,33 @@
 
 
 
+/**
+ * Cortex-A9 private timer and watchdog.
+ * Each processor has its own private timer and watchdog, at the same address
+ * (ARM_PWT_BASE_OFFSET from the peripheral base), clocked by PERIPHCLK.
+ *
+ * The private timer is a 32-bit decrementing counter: when it reaches zero,
+ * it sets its event flag, raises its interrupt (if enabled) and either stops
+ * (one-shot) or reloads from the load register (auto-reload).
+ * Writing the load register also writes the counter: programming the timer is one store.
+ * The counter decrements every (prescaler+1) PERIPHCLK cycles.
+ */
+#define TIMER_OFF_REGISTER_LOAD					0x00
+#define TIMER_OFF_REGISTER_COUNTER				0x04
+#define TIMER_OFF_REGISTER_CONTROL				0x08
+#define TIMER_OFF_REGISTER_INTERRUPT_STATUS			0x0C
+
+/**
+ * Index in the private timer control register where to find the given informations
+ */
+#define TIMER_BIT_REGISTER_CONTROL_PRESCALER			8	// 8 bits
+#define TIMER_BIT_REGISTER_CONTROL_INTERUPT_ENABLE		2
+#define TIMER_BIT_REGISTER_CONTROL_AUTO_RELOAD			1
+#define TIMER_BIT_REGISTER_CONTROL_TIMER_ENABLE			0
+
+#define TIMER_MASK_REGISTER_CONTROL_PRESCALER			(0xFF << TIMER_BIT_REGISTER_CONTROL_PRESCALER)
+
+
 /**
  * Offset of the watchdog private registers (relative to 
  * the base address of the watchdog private memory region)
@@ -34,21 +62,41 @@
 #define TIMER_OFF_WATCHDOG_REGISTER_LOAD			0x20
 #define TIMER_OFF_WATCHDOG_REGISTER_COUNTER			0x24
 #define TIMER_OFF_WATCHDOG_REGISTER_CONTROL			0x28
+#define TIMER_OFF_WATCHDOG_REGISTER_INTERRUPT_STATUS		0x2C
 
 
 /**
  * Index in the watchdog control register where to find the given informations
+ * The watchdog comes out of reset in timer mode: it is then a second private timer,
+ * with its own interrupt, used for the latency watchdog.
  */
 #define TIMER_BIT_WATCHDOG_REGISTER_CONTROL_WATCHDOG_MODE	3
 #define TIMER_BIT_WATCHDOG_REGISTER_CONTROL_INTERUPT_ENABLE	2
 #define TIMER_BIT_WATCHDOG_REGISTER_CONTROL_AUTO_RELOAD		1
 #define TIMER_BIT_WATCHDOG_REGISTER_CONTROL_WATCHDOG_ENABLE	0
 
+/**
+ * Private interrupts (PPI) of the private timer and of the watchdog
+ */
+#define TIMER_PRIVATE_IRQ					29
+#define TIMER_WATCHDOG_IRQ					30
+
+
 
 
+void		timer_init		(uint8_t prescaler);
+uint32_t	timer_freq		();
+void		timer_arm_oneshot	(uint32_t ticks);
+void		timer_arm_periodic	(uint32_t ticks);
+void		timer_reprogram		(uint32_t ticks);
+void		timer_disarm		();
+void		timer_ack		();
+void		timer_get_state		(uint32_t *load, uint32_t *counter, uint32_t *control);
 
-void	setTimmer	(uint32_t time, char multipleShot);
-void	unsetTimmer	();
+void		timer_watchdog_arm_periodic	(uint32_t ticks);
+void		timer_watchdog_arm_oneshot	(uint32_t ticks);
+void		timer_watchdog_disarm		();
+void		timer_watchdog_ack		();
 
 
 
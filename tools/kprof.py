@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+#
+# Symbolizes the samples of the kernel sampling profiler (kprof.c).
+#
+# The samples are read from a file (a capture of "prof dump" on the console,
+# or of "prof stream" on the spare serial line), from the standard input,
+# or straight from the spare serial line when QEMU exposes it on a TCP socket.
+#
+# The PCs are resolved against the symbols of the kernel .elf (with nm),
+# and the script prints a flat profile. With --folded, it also writes the
+# folded stacks, "caller;function count" per line, for flamegraph.pl.
+# The caller is the function of the LR of the interrupted code: it is only
+# exact when the sample hits a leaf function, or right after a call.
+#
+# Examples:
+#   tools/kprof.py --elf vexpress-a9.elf capture.txt
+#   tools/kprof.py --elf vexpress-a9.elf --port 7777 --folded kprof.folded
+#
+
+import argparse
+import bisect
+import collections
+import socket
+import subprocess
+import sys
+
+
+def load_symbols(elf, nm):
+    out = subprocess.run([nm, "-n", "--defined-only", elf], check=True,
+                         stdout=subprocess.PIPE, universal_newlines=True).stdout
+    addrs, names = [], []
+    for line in out.splitlines():
+        fields = line.split()
+        if len(fields) != 3 or fields[1] not in "tTwW":
+            continue
+        addr = int(fields[0], 16)
+        # ARM mapping symbols ($a, $d, $t) are not functions.
+        if fields[2].startswith("$"):
+            continue
+        addrs.append(addr)
+        names.append(fields[2])
+    return addrs, names
+
+
+def symbolize(addrs, names, pc):
+    i = bisect.bisect_right(addrs, pc) - 1
+    if i < 0:
+        return "0x%08x" % pc
+    return names[i]
+
+
+def read_lines(args):
+    if args.port:
+        sock = socket.create_connection(("127.0.0.1", args.port))
+        data = b""
+        while b"# kprof end" not in data:
+            chunk = sock.recv(4096)
+            if not chunk:
+                break
+            data += chunk
+        sock.close()
+        return data.decode("ascii", "replace").splitlines()
+    if args.input == "-":
+        return sys.stdin.read().splitlines()
+    with open(args.input, errors="replace") as f:
+        return f.read().splitlines()
+
+
+def parse(lines):
+    samples = []
+    headers = []
+    for line in lines:
+        line = line.strip().strip("\r")
+        if line.startswith("# kprof"):
+            if line != "# kprof end":
+                headers.append(line[2:])
+            continue
+        fields = line.split()
+        if len(fields) != 2:
+            continue
+        try:
+            samples.append((int(fields[0], 16), int(fields[1], 16)))
+        except ValueError:
+            continue
+    return headers, samples
+
+
+def main():
+    parser = argparse.ArgumentParser(description="kernel profiler symbolizer")
+    parser.add_argument("input", nargs="?", default="-",
+                        help="capture of the dump, - for the standard input")
+    parser.add_argument("--elf", required=True, help="kernel .elf")
+    parser.add_argument("--nm", default="arm-none-eabi-nm")
+    parser.add_argument("--port", type=int,
+                        help="read the stream from this TCP port (QEMU serial line)")
+    parser.add_argument("--folded", help="write the folded stacks to this file")
+    parser.add_argument("--top", type=int, default=30,
+                        help="number of functions in the flat profile")
+    args = parser.parse_args()
+
+    addrs, names = load_symbols(args.elf, args.nm)
+    headers, samples = parse(read_lines(args))
+    if not samples:
+        sys.exit("kprof: no samples")
+
+    flat = collections.Counter()
+    folded = collections.Counter()
+    for pc, lr in samples:
+        function = symbolize(addrs, names, pc)
+        caller = symbolize(addrs, names, lr)
+        flat[function] += 1
+        if caller != function:
+            folded["%s;%s" % (caller, function)] += 1
+        else:
+            folded[function] += 1
+
+    for header in headers:
+        print(header)
+    total = len(samples)
+    print("%d samples" % total)
+    print("%8s %7s  %s" % ("samples", "%", "function"))
+    for function, count in flat.most_common(args.top):
+        print("%8d %6.2f%%  %s" % (count, 100.0 * count / total, function))
+
+    if args.folded:
+        with open(args.folded, "w") as f:
+            for stack, count in sorted(folded.items()):
+                f.write("%s %d\n" % (stack, count))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,176 @@
+#!/usr/bin/env python3
+#
+# Converts the event trace of the kernel (ktrace.c) to the Chrome trace event
+# JSON format, loaded by chrome://tracing or https://ui.perfetto.dev.
+#
+# The binary trace is read from a file (a capture of "trace stream" on the
+# spare serial line), or straight from the spare serial line when QEMU exposes
+# it on a TCP socket. See ktrace.h for the format.
+#
+# Each processor is a track, with the nested IRQ tops, bottoms, timer callbacks
+# and events as slices. The thread switches are instants on the processor track,
+# and slices on one track per thread, in a separate "threads" process.
+# A thread may be switched out within a slice (a bottom, an event): its open
+# slices are ended on the processor track at the switch, and begun again when
+# it is switched back in, so that the slices of the processor track nest.
+# With the kernel .elf, the timer callbacks and event reactions are symbolized.
+#
+# Examples:
+#   tools/ktrace.py --elf vexpress-a9.elf capture.bin trace.json
+#   tools/ktrace.py --elf vexpress-a9.elf --port 7777 trace.json
+#
+
+import argparse
+import json
+import socket
+import struct
+import sys
+
+from kprof import load_symbols, symbolize
+
+KINDS = ["irq", "bottom", "timer", "event", "switch"]
+KIND_TOP, KIND_BOTTOM, KIND_TIMER, KIND_EVENT, KIND_SWITCH = range(5)
+PHASE_BEGIN, PHASE_END, PHASE_INSTANT = range(3)
+RECORD = struct.Struct("<IIBBH")
+
+
+def read_stream(args):
+    if args.port:
+        sock = socket.create_connection(("127.0.0.1", args.port))
+        data = b""
+        while not data.endswith(b"KEND"):
+            chunk = sock.recv(65536)
+            if not chunk:
+                break
+            data += chunk
+        sock.close()
+        return data
+    with open(args.input, "rb") as f:
+        return f.read()
+
+
+def parse(data):
+    start = data.find(b"KTRC")
+    if start < 0:
+        sys.exit("ktrace: no trace header")
+    offset = start + 4
+    version, nb_cpus, hz = struct.unpack_from("<III", data, offset)
+    offset += 12
+    if version != 1:
+        sys.exit("ktrace: unknown version %d" % version)
+    cpus = {}
+    for _ in range(nb_cpus):
+        cpu, count = struct.unpack_from("<II", data, offset)
+        offset += 8
+        records = []
+        for _ in range(count):
+            records.append(RECORD.unpack_from(data, offset)[:4])
+            offset += RECORD.size
+        cpus[cpu] = records
+    return hz, cpus
+
+
+def unwrap(records):
+    """Extend the 32-bit stamps to 64 bits, assuming they are less than a wrap apart."""
+    base, last, out = 0, None, []
+    for stamp, arg, kind, phase in records:
+        if last is not None and stamp < last:
+            base += 1 << 32
+        last = stamp
+        out.append((base + stamp, arg, kind, phase))
+    return out
+
+
+def name_of(kind, arg, symbols):
+    if kind == KIND_TOP:
+        return "irq %d top" % arg
+    if kind == KIND_BOTTOM:
+        return "irq %d bottom" % arg
+    if kind in (KIND_TIMER, KIND_EVENT):
+        target = symbolize(*symbols, arg) if symbols else "0x%08x" % arg
+        return "%s %s" % (KINDS[kind], target)
+    return "switch %d -> %d" % (arg >> 16, arg & 0xFFFF)
+
+
+def convert(hz, cpus, symbols):
+    events = [{"name": "process_name", "ph": "M", "pid": 0, "args": {"name": "cpus"}},
+              {"name": "process_name", "ph": "M", "pid": 1, "args": {"name": "threads"}}]
+    tracks = {cpu: unwrap(records) for cpu, records in cpus.items() if records}
+    if not tracks:
+        sys.exit("ktrace: no records")
+    origin = min(records[0][0] for records in tracks.values())
+
+    def ts(stamp):
+        return (stamp - origin) * 1e6 / hz
+
+    for cpu, records in sorted(tracks.items()):
+        events.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": cpu,
+                       "args": {"name": "cpu%d" % cpu}})
+        opened = []       # slices open on the processor track, (name, kind)
+        suspended = {}    # thread id -> its slices open when switched out
+        running = None
+        for stamp, arg, kind, phase in records:
+            name = name_of(kind, arg, symbols)
+            if phase == PHASE_BEGIN:
+                opened.append((name, kind))
+                events.append({"name": name, "cat": KINDS[kind], "ph": "B",
+                               "pid": 0, "tid": cpu, "ts": ts(stamp)})
+            elif phase == PHASE_END:
+                # The begin may have been overwritten in the ring.
+                if not opened:
+                    continue
+                opened.pop()
+                events.append({"name": name, "cat": KINDS[kind], "ph": "E",
+                               "pid": 0, "tid": cpu, "ts": ts(stamp)})
+            else:
+                events.append({"name": name, "cat": KINDS[kind], "ph": "i", "s": "t",
+                               "pid": 0, "tid": cpu, "ts": ts(stamp)})
+                if kind != KIND_SWITCH:
+                    continue
+                prev, nxt = arg >> 16, arg & 0xFFFF
+                for slice_name, slice_kind in reversed(opened):
+                    events.append({"name": slice_name, "cat": KINDS[slice_kind], "ph": "E",
+                                   "pid": 0, "tid": cpu, "ts": ts(stamp)})
+                suspended[prev] = opened
+                opened = suspended.pop(nxt, [])
+                for slice_name, slice_kind in opened:
+                    events.append({"name": slice_name, "cat": KINDS[slice_kind], "ph": "B",
+                                   "pid": 0, "tid": cpu, "ts": ts(stamp)})
+                if running == prev:
+                    events.append({"name": "thread %d" % prev, "ph": "E",
+                                   "pid": 1, "tid": prev, "ts": ts(stamp)})
+                events.append({"name": "thread %d" % nxt, "ph": "B",
+                               "pid": 1, "tid": nxt, "ts": ts(stamp)})
+                running = nxt
+    return {"traceEvents": events, "displayTimeUnit": "ns"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="kernel trace to Chrome trace JSON")
+    parser.add_argument("input", nargs="?", help="capture of the stream")
+    parser.add_argument("output", nargs="?", default="-",
+                        help="JSON trace, - for the standard output")
+    parser.add_argument("--elf", help="kernel .elf, to symbolize the handlers")
+    parser.add_argument("--nm", default="arm-none-eabi-nm")
+    parser.add_argument("--port", type=int,
+                        help="read the stream from this TCP port (QEMU serial line)")
+    args = parser.parse_args()
+    if args.port and args.input and args.output == "-":
+        args.output, args.input = args.input, None
+    if not args.port and not args.input:
+        parser.error("an input capture or --port is required")
+
+    symbols = load_symbols(args.elf, args.nm) if args.elf else None
+    hz, cpus = parse(read_stream(args))
+    trace = convert(hz, cpus, symbols)
+    if args.output == "-":
+        json.dump(trace, sys.stdout)
+    else:
+        with open(args.output, "w") as f:
+            json.dump(trace, f)
+    print("ktrace: %d events, %d processors, %d Hz" % (len(trace["traceEvents"]), len(cpus), hz),
+          file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
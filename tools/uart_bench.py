@@ -0,0 +1,283 @@
+#!/usr/bin/env python3
+#
+# UART echo benchmark, see the bench_uart target in the Makefile.
+#
+# Boots the kernel in QEMU with its two first serial lines (UART0, UART1)
+# on TCP sockets, then drives UART0 (stdin) from this script and listens
+# on UART1 (stdout), where the kernel echoes the received characters.
+# The kernel must be built with CONFIG_LOCAL_ECHO=n and CONFIG_CONSOLE=n.
+# The XON/XOFF sent by the kernel on UART0 are honored, so the kernel
+# may be built with CONFIG_UART_XONXOFF=y.
+#
+# Measures:
+#   - the round-trip latency of one character, UART0 -> kernel -> UART1,
+#   - the delivered throughput and the loss, when sending at given rates.
+#
+# Results are merged in a JSON file, under the given mode name
+# (typically "polling" or "irq"), for regression tracking.
+#
+
+import argparse
+import json
+import os
+import random
+import shlex
+import socket
+import subprocess
+import sys
+import threading
+import time
+
+BOOT_BANNER = b"Characters will appear here..."
+
+XON = 0x11
+XOFF = 0x13
+
+# Bytes the kernel may interpret rather than echo: CR, XON, XOFF, BS, DEL.
+SPECIAL_BYTES = {0x0d, 0x11, 0x13, 0x08, 0x7f}
+PAYLOAD_BYTES = bytes(b for b in range(0x20, 0x7f) if b not in SPECIAL_BYTES)
+
+
+class Line:
+    """A serial line, connected to a QEMU TCP chardev, read by a thread."""
+
+    def __init__(self, port, timeout):
+        deadline = time.time() + timeout
+        while True:
+            try:
+                self.sock = socket.create_connection(("127.0.0.1", port))
+                break
+            except OSError:
+                if time.time() > deadline:
+                    raise
+                time.sleep(0.05)
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.cond = threading.Condition()
+        self.data = bytearray()
+        self.stamps = []
+        self.closed = False
+        self.stopped = False
+        self.xoffs = 0
+        self.thread = threading.Thread(target=self._reader, daemon=True)
+        self.thread.start()
+
+    def _reader(self):
+        while True:
+            try:
+                chunk = self.sock.recv(4096)
+            except OSError:
+                chunk = b""
+            now = time.perf_counter()
+            with self.cond:
+                if not chunk:
+                    self.closed = True
+                    self.cond.notify_all()
+                    return
+                self.data += chunk
+                self.stamps.append((now, len(self.data)))
+                for b in chunk:
+                    if b == XOFF:
+                        self.stopped = True
+                        self.xoffs += 1
+                    elif b == XON:
+                        self.stopped = False
+                self.cond.notify_all()
+
+    def send(self, data):
+        """Send, unless the peer sent XOFF: then wait for its XON."""
+        with self.cond:
+            while self.stopped and not self.closed:
+                self.cond.wait()
+        self.sock.sendall(data)
+
+    def mark(self):
+        with self.cond:
+            return len(self.data)
+
+    def wait_for(self, pattern, start, timeout):
+        """Wait until pattern appears after offset start, return its offset and time."""
+        deadline = time.perf_counter() + timeout
+        with self.cond:
+            while True:
+                pos = self.data.find(pattern, start)
+                if pos >= 0:
+                    return pos, time.perf_counter()
+                remaining = deadline - time.perf_counter()
+                if remaining <= 0 or self.closed:
+                    return -1, None
+                self.cond.wait(remaining)
+
+    def wait_idle(self, idle, timeout):
+        """Wait until nothing was received for idle seconds."""
+        deadline = time.perf_counter() + timeout
+        with self.cond:
+            while True:
+                last = self.stamps[-1][0] if self.stamps else 0
+                now = time.perf_counter()
+                if now - last >= idle or now >= deadline or self.closed:
+                    return
+                self.cond.wait(idle - (now - last))
+
+    def since(self, start):
+        with self.cond:
+            return bytes(self.data[start:]), [s for s in self.stamps if s[1] > start]
+
+    def close(self):
+        try:
+            self.sock.close()
+        except OSError:
+            pass
+
+
+def percentile(values, p):
+    values = sorted(values)
+    if not values:
+        return None
+    k = min(len(values) - 1, int(round(p / 100.0 * (len(values) - 1))))
+    return values[k]
+
+
+def measure_latency(stdin, stdout, samples, timeout):
+    rtts = []
+    lost = 0
+    for i in range(samples):
+        c = PAYLOAD_BYTES[i % len(PAYLOAD_BYTES):][:1]
+        start = stdout.mark()
+        t0 = time.perf_counter()
+        stdin.send(c)
+        pos, t1 = stdout.wait_for(c, start, timeout)
+        if pos < 0:
+            lost += 1
+            continue
+        rtts.append((t1 - t0) * 1e6)
+    result = {"samples": samples, "lost": lost}
+    if rtts:
+        result.update({
+            "min_us": round(min(rtts), 1),
+            "mean_us": round(sum(rtts) / len(rtts), 1),
+            "p50_us": round(percentile(rtts, 50), 1),
+            "p99_us": round(percentile(rtts, 99), 1),
+            "max_us": round(max(rtts), 1),
+        })
+    return result
+
+
+def matched_in_order(sent, received):
+    """Number of sent bytes found, in order, in the received bytes."""
+    i = 0
+    for b in received:
+        if i < len(sent) and b == sent[i]:
+            i += 1
+    return i
+
+
+def measure_throughput(stdin, stdout, rate, nbytes, chunk, idle):
+    rnd = random.Random(rate)
+    payload = bytes(rnd.choice(PAYLOAD_BYTES) for _ in range(nbytes))
+    start = stdout.mark()
+    xoffs = stdin.xoffs
+    t0 = time.perf_counter()
+    sent = 0
+    while sent < nbytes:
+        n = min(chunk, nbytes - sent)
+        if rate > 0:
+            delay = t0 + sent / float(rate) - time.perf_counter()
+            if delay > 0:
+                time.sleep(delay)
+        stdin.send(payload[sent:sent + n])
+        sent += n
+    t_sent = time.perf_counter()
+    stdout.wait_idle(idle, timeout=max(10.0, 4.0 * nbytes / max(rate, 1000)))
+    received, stamps = stdout.since(start)
+    matched = matched_in_order(payload, received)
+    t_last = stamps[-1][0] if stamps else t_sent
+    elapsed = max(t_last - t0, 1e-9)
+    return {
+        "rate_bps": rate,
+        "sent": nbytes,
+        "received": len(received),
+        "lost": nbytes - matched,
+        "unexpected": len(received) - matched,
+        "send_s": round(t_sent - t0, 4),
+        "elapsed_s": round(elapsed, 4),
+        "delivered_bps": round(len(received) / elapsed, 1),
+        "xoffs": stdin.xoffs - xoffs,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--qemu", required=True,
+                        help="QEMU command line, without the serial lines")
+    parser.add_argument("--mode", required=True,
+                        help="name of the measured configuration (polling, irq...)")
+    parser.add_argument("--output", default="bench_uart.json")
+    parser.add_argument("--stdin-port", type=int, default=5555)
+    parser.add_argument("--stdout-port", type=int, default=6666)
+    parser.add_argument("--latency-samples", type=int, default=200)
+    parser.add_argument("--rates", default="1000,10000,50000,0",
+                        help="comma separated sending rates in bytes/s, 0 for unpaced")
+    parser.add_argument("--bytes", type=int, default=20000,
+                        help="bytes sent per throughput run")
+    parser.add_argument("--chunk", type=int, default=16,
+                        help="bytes per socket write")
+    parser.add_argument("--boot-timeout", type=float, default=20.0)
+    args = parser.parse_args()
+
+    serial = "tcp:127.0.0.1:%d,server=on,wait=on"
+    cmd = shlex.split(args.qemu) + [
+        "-serial", serial % args.stdin_port,
+        "-serial", serial % args.stdout_port,
+        "-monitor", "none",
+    ]
+    qemu = subprocess.Popen(cmd, stdin=subprocess.DEVNULL,
+                            stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+    stdin = stdout = None
+    try:
+        # QEMU waits for the connections in the order of the serial lines.
+        stdin = Line(args.stdin_port, args.boot_timeout)
+        stdout = Line(args.stdout_port, args.boot_timeout)
+        pos, _ = stdout.wait_for(BOOT_BANNER, 0, args.boot_timeout)
+        if pos < 0:
+            sys.exit("uart_bench: the kernel did not boot (no banner on UART1)")
+        stdout.wait_idle(0.5, args.boot_timeout)
+
+        result = {
+            "mode": args.mode,
+            "date": time.strftime("%Y-%m-%dT%H:%M:%S"),
+            "qemu": args.qemu,
+            "latency": measure_latency(stdin, stdout, args.latency_samples, 1.0),
+            "throughput": [],
+        }
+        for rate in [int(r) for r in args.rates.split(",") if r]:
+            result["throughput"].append(
+                measure_throughput(stdin, stdout, rate, args.bytes, args.chunk, 1.0))
+    finally:
+        for line in (stdin, stdout):
+            if line:
+                line.close()
+        qemu.terminate()
+        try:
+            qemu.wait(5)
+        except subprocess.TimeoutExpired:
+            qemu.kill()
+
+    results = {}
+    if os.path.exists(args.output):
+        with open(args.output) as f:
+            results = json.load(f)
+    results[args.mode] = result
+    with open(args.output, "w") as f:
+        json.dump(results, f, indent=2, sort_keys=True)
+        f.write("\n")
+
+    lat = result["latency"]
+    print("%s: latency p50=%sus p99=%sus lost=%d" %
+          (args.mode, lat.get("p50_us"), lat.get("p99_us"), lat["lost"]))
+    for t in result["throughput"]:
+        print("%s: rate=%d delivered=%.0fB/s lost=%d" %
+              (args.mode, t["rate_bps"], t["delivered_bps"], t["lost"]))
+
+
+if __name__ == "__main__":
+    main()
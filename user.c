@@ -24,6 +24,19 @@ void sleep(uint32_t delay) {
   __asm volatile ("swi #0x01" ::: );
 }
 
+/*
+ * Processor time of a thread (0xFFFFFFFF for the current one), in cycles:
+ * kernel, user, interrupt and idle (see kthread.h). Returns 0, or -1 if
+ * there is no such thread.
+ */
+int times(uint32_t id, uint64_t cycles[4]) {
+  register uint32_t r0 __asm__("r0") = id;
+  register uint64_t *r1 __asm__("r1") = cycles;
+  /* swi_handler is C code: r1-r3, r12 and the flags are not preserved */
+  __asm volatile ("swi #0x02" : "+r" (r0), "+r" (r1) : : "r2", "r3", "r12", "cc", "memory");
+  return (int)r0;
+}
+
 /*
  * WARNING: do not change this signature without changing the assembly code
  * in gic.s -> see _arm_usr_mode
@@ -56,6 +69,13 @@ void main(uint32_t pid) {
    */
   sleep(0x1234);
 
+  /*
+   * And one that is: the processor time used so far by this "process".
+   */
+  uint64_t cycles[4];
+  if (times(0xFFFFFFFF, cycles) == 0)
+    kprintf("USER[%d]: user=%llu kernel=%llu irq=%llu cycles\n",pid,cycles[1],cycles[0],cycles[2]);
+
   /*
    * Terminate this "process"...
    */